@@ -0,0 +1,261 @@
+#include "benchmarkharness.h"
+#include "syntheticcorpus.h"
+
+#include "documentextractor.h"
+#include "outpututils.h"
+#include "pdfrenderer.h"
+#include "textextractutils.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#undef snprintf
+#include <boost/program_options.hpp>
+
+using namespace textextract;
+namespace po = boost::program_options;
+
+namespace {
+	// A page of a benchmark document, loaded once and shared by the stage benchmarks.
+	struct LoadedPage {
+		ScopedFPDFPage page;
+		ScopedFPDFTextPage textPage;
+		std::wstring rawText;
+		PageDimensions pageDims;
+	};
+
+	bool LoadPage(FPDF_DOCUMENT doc, int index, LoadedPage& loaded) {
+		loaded.page.reset(FPDF_LoadPage(doc, index));
+		if (!loaded.page) return false;
+		loaded.textPage.reset(FPDFText_LoadPage(loaded.page.get()));
+		if (!loaded.textPage) return false;
+		for (int i = 0; i < FPDFText_CountChars(loaded.textPage.get()); i++) {
+			loaded.rawText += FPDFText_GetUnicode(loaded.textPage.get(), i);
+		}
+		SetPageSize(FPDF_GetPageWidth(loaded.page.get()), FPDF_GetPageHeight(loaded.page.get()));
+		loaded.pageDims = GetPageSize().GetPageDimensions();
+		return true;
+	}
+
+	// Time each stage of the extraction pipeline on its own, on pages of a document.
+	void BenchmarkStages(const std::filesystem::path& pdfPath, int maxPages, int dpi,
+		const std::filesystem::path& scratchPath, const BenchmarkSettings& settings,
+		std::vector<BenchmarkResult>& results) {
+		size_t length = 0;
+		std::unique_ptr<char, pdfium::FreeDeleter> buffer = GetFileContents(pdfPath.string().c_str(), &length);
+		if (!buffer) return;
+		ScopedFPDFDocument doc(FPDF_LoadMemDocument(buffer.get(), static_cast<int>(length), nullptr));
+		if (!doc) {
+			std::cerr << "Failed to load " << pdfPath.string() << std::endl;
+			return;
+		}
+		int pagecount = std::min(FPDF_GetPageCount(doc.get()), maxPages);
+		for (int i = 0; i < pagecount; i++) {
+			LoadedPage loaded;
+			if (!LoadPage(doc.get(), i, loaded)) continue;
+			std::string input = pdfPath.stem().string() + "pg" + std::to_string(i + 1);
+			PageDimensions renderdims(dpi * loaded.pageDims.width / 72, dpi * loaded.pageDims.height / 72);
+
+			std::vector<std::wstring> tokens = GetWordTokens(loaded.rawText);
+			results.push_back(RunBenchmark("stage/GetWordTokens", input, settings, [&]() {
+				GetWordTokens(loaded.rawText);
+			}));
+
+			std::vector<TextBox> boxes = GetTextBoxesFromTokens(
+				tokens, loaded.textPage.get(), loaded.pageDims.width, loaded.pageDims.height);
+			results.push_back(RunBenchmark("stage/GetTextBoxesFromTokens", input, settings, [&]() {
+				GetTextBoxesFromTokens(tokens, loaded.textPage.get(), loaded.pageDims.width, loaded.pageDims.height);
+			}));
+
+			// Both stages change the boxes in place, so each call works on a fresh copy.
+			// The copy is part of the measured time.
+			results.push_back(RunBenchmark("stage/RemoveWaterMarkText", input, settings, [&]() {
+				std::vector<TextBox> copy = boxes;
+				RemoveWaterMarkText(copy);
+			}));
+			RemoveWaterMarkText(boxes);
+			results.push_back(RunBenchmark("stage/RescaleTextBoxes", input, settings, [&]() {
+				std::vector<TextBox> copy = boxes;
+				RescaleTextBoxes(copy, loaded.pageDims, renderdims);
+			}));
+			RescaleTextBoxes(boxes, loaded.pageDims, renderdims);
+
+			results.push_back(RunBenchmark("stage/RenderPage", input, settings, [&]() {
+				RenderStatus status;
+				RenderLoadedPage(loaded.page.get(), dpi, RenderProfile::FAITHFUL, status);
+			}));
+
+			SetPageWords(boxes);
+			SetRenderDimensions(renderdims);
+			SetRenderStatus(RenderStatus::COMPLETE);
+			SetRenderDpi(dpi);
+			std::string jsonpath = (scratchPath / "benchmark.json").string();
+			results.push_back(RunBenchmark("stage/WriteJSON", input, settings, [&]() {
+				WriteJSON(jsonpath);
+			}));
+			ClearPageInfo();
+		}
+	}
+
+	// Time the whole pipeline over the pages of a document, as the extractor runs it.
+	void BenchmarkDocument(PdfRenderer& pdf, const std::string& name, int maxPages, int dpi,
+		const std::filesystem::path& scratchPath, const BenchmarkSettings& settings,
+		std::vector<BenchmarkResult>& results) {
+		RenderOptions options;
+		options.dpi = dpi;
+		int pagecount = std::min(pdf.GetPageCount(), maxPages);
+		std::string jsonpath = (scratchPath / "benchmark.json").string();
+		results.push_back(RunBenchmark("document/end_to_end", name, settings, [&]() {
+			for (int i = 0; i < pagecount; i++) {
+				pdf.GetPageInfo(i, options);
+				WriteJSON(jsonpath);
+				ClearPageInfo();
+			}
+			// Each iteration loads the document again, as a run over a new document would.
+			pdf.CloseDocument();
+		}));
+	}
+
+	// Counts what is streamed to it, so that every piece of a page is used.
+	class CountingVisitor : public PageVisitor {
+	public:
+		size_t characters = 0;
+		size_t words = 0;
+		size_t renderRows = 0;
+
+		void OnRawTextChunk(const std::wstring& chunk) override { characters += chunk.size(); }
+		void OnWord(const TextBox& word) override { words++; }
+		void OnRenderTile(int top, const cv::Mat& tile) override { renderRows += tile.rows; }
+	};
+
+	// Time streaming the pages of a document through DocumentExtractor, for comparison
+	// with the page information pipeline of BenchmarkDocument.
+	void BenchmarkStreamed(const std::filesystem::path& pdfPath, int maxPages, int dpi,
+		const BenchmarkSettings& settings, std::vector<BenchmarkResult>& results) {
+		DocumentExtractor extractor(pdfPath.string());
+		if (!extractor.IsLoaded()) return;
+		StreamOptions options;
+		options.render.dpi = dpi;
+		options.renderTiles = true;
+		int pagecount = std::min(extractor.GetPageCount(), maxPages);
+		results.push_back(RunBenchmark("document/streamed", pdfPath.stem().string(), settings, [&]() {
+			CountingVisitor visitor;
+			for (int page = 1; page <= pagecount; page++) {
+				extractor.ExtractPage(page, options, visitor);
+			}
+			// Each iteration loads the document again, as in BenchmarkDocument.
+			extractor.Close();
+		}));
+	}
+
+	void BenchmarkFile(const std::filesystem::path& pdfPath, int maxPages, int dpi,
+		const std::filesystem::path& scratchPath, const BenchmarkSettings& settings,
+		std::vector<BenchmarkResult>& results) {
+		std::cout << "benchmarking " << pdfPath.filename().string() << std::endl;
+		{
+			// The renderer initializes pdfium, which the stage benchmarks also rely on.
+			PdfRenderer pdf(pdfPath.string());
+			if (!pdf.BufferLoaded()) {
+				std::cerr << "Failed to load the PDF from path: " << pdfPath.string() << std::endl;
+				return;
+			}
+			BenchmarkStages(pdfPath, maxPages, dpi, scratchPath, settings, results);
+			BenchmarkDocument(pdf, pdfPath.stem().string(), maxPages, dpi, scratchPath, settings, results);
+		}
+		// pdfium only allows one user at a time, so the extractor waits for the renderer to go.
+		BenchmarkStreamed(pdfPath, maxPages, dpi, settings, results);
+	}
+} // namespace
+
+int main(int argc, char* argv[]) {
+	BenchmarkSettings settings;
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h", "Produce help message.")
+		("corpus,c", po::value<std::string>()->default_value(""), "Directory of real PDF files to benchmark, in addition to the synthetic documents.")
+		("nosynthetic", po::bool_switch(), "Skip the generated synthetic documents.")
+		("maxpages", po::value<int>()->default_value(3), "Most pages benchmarked from each document.")
+		("dpi", po::value<int>()->default_value(300), "Resolution of page renders in dots per inch.")
+		("repetitions", po::value<int>(&settings.repetitions)->default_value(15), "Timed repetitions of each benchmark.")
+		("mintime", po::value<double>(&settings.minRepetitionMs)->default_value(20.0), "Shortest time in milliseconds of a single repetition.")
+		("output,o", po::value<std::string>()->default_value("benchmark_results.json"), "Path to write the JSON results to.")
+		("baseline,b", po::value<std::string>()->default_value(""), "Path to results of an earlier run to compare against.")
+		("tolerance", po::value<double>()->default_value(10.0), "Slowdown in percent over the baseline that counts as a regression.");
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if (vm.count("help")) {
+		std::cout << desc << "\n";
+		return 1;
+	}
+
+	std::filesystem::path scratchpath = std::filesystem::temp_directory_path() / "pdfium_text_extract_benchmark";
+	std::filesystem::create_directories(scratchpath);
+	int maxpages = vm["maxpages"].as<int>();
+	int dpi = vm["dpi"].as<int>();
+	std::vector<BenchmarkResult> results;
+
+	if (!vm["nosynthetic"].as<bool>()) {
+		std::vector<SyntheticDocumentSpec> specs(3);
+		specs[0].name = "synthetic_sparse";
+		specs[0].wordsPerPage = 50;
+		specs[1].name = "synthetic_dense";
+		specs[1].wordsPerPage = 800;
+		specs[1].fontSize = 7.0f;
+		specs[2].name = "synthetic_no_watermark";
+		specs[2].watermark = false;
+		std::vector<std::filesystem::path> generated;
+		FPDF_InitLibrary();
+		for (const auto& spec : specs) {
+			std::filesystem::path pdfpath = scratchpath / (spec.name + ".pdf");
+			if (WriteSyntheticDocument(spec, pdfpath)) {
+				generated.push_back(pdfpath);
+			}
+			else {
+				std::cerr << "Failed to generate " << spec.name << std::endl;
+			}
+		}
+		FPDF_DestroyLibrary();
+		for (const auto& pdfpath : generated) {
+			BenchmarkFile(pdfpath, maxpages, dpi, scratchpath, settings, results);
+		}
+	}
+
+	std::string corpus = vm["corpus"].as<std::string>();
+	if (!corpus.empty()) {
+		std::vector<std::filesystem::path> files;
+		for (const auto& entry : std::filesystem::directory_iterator(corpus)) {
+			if (entry.path().extension() == ".pdf") files.push_back(entry.path());
+		}
+		// Sorted so that runs list results in the same order.
+		std::sort(files.begin(), files.end());
+		for (const auto& file : files) {
+			BenchmarkFile(file, maxpages, dpi, scratchpath, settings, results);
+		}
+	}
+
+	PrintBenchmarkResults(results, std::cout);
+	std::string outputpath = vm["output"].as<std::string>();
+	std::ofstream output(outputpath);
+	if (!output.is_open()) {
+		std::cerr << "Error opening the results file: " << outputpath << std::endl;
+		return EXIT_FAILURE;
+	}
+	output << ResultsToJson(results, settings).dump(4);
+	output.close();
+
+	std::string baselinepath = vm["baseline"].as<std::string>();
+	if (!baselinepath.empty()) {
+		std::vector<BenchmarkResult> baseline;
+		if (!ReadBaseline(baselinepath, baseline)) return EXIT_FAILURE;
+		std::cout << "\n";
+		int regressions = CompareToBaseline(results, baseline, vm["tolerance"].as<double>() / 100.0, std::cout);
+		if (regressions > 0) {
+			std::cerr << regressions << " benchmark(s) regressed against " << baselinepath << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,173 @@
+#include "benchmarkharness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace textextract {
+	namespace {
+		// Most calls made in a single repetition, for functions the clock cannot resolve.
+		const int MAX_ITERATIONS = 1 << 24;
+
+		double Median(std::vector<double> values) {
+			if (values.empty()) return 0.0;
+			std::sort(values.begin(), values.end());
+			size_t middle = values.size() / 2;
+			return values.size() % 2 == 0 ?
+				(values[middle - 1] + values[middle]) / 2.0 : values[middle];
+		}
+
+		double TimeIterations(const std::function<void()>& function, int iterations) {
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; i++) {
+				function();
+			}
+			auto end = std::chrono::steady_clock::now();
+			return std::chrono::duration<double, std::nano>(end - start).count();
+		}
+
+		std::string FormatNs(double ns) {
+			std::ostringstream out;
+			out << std::fixed << std::setprecision(2);
+			if (ns >= 1e9) out << ns / 1e9 << " s";
+			else if (ns >= 1e6) out << ns / 1e6 << " ms";
+			else if (ns >= 1e3) out << ns / 1e3 << " us";
+			else out << ns << " ns";
+			return out.str();
+		}
+	} // namespace
+
+	BenchmarkResult RunBenchmark(const std::string& name, const std::string& input,
+		const BenchmarkSettings& settings, const std::function<void()>& function) {
+		BenchmarkResult result;
+		result.name = name;
+		result.input = input;
+
+		TimeIterations(function, settings.warmupIterations);
+		// Double the calls per repetition until one repetition takes the minimum time.
+		double minrepetitionns = settings.minRepetitionMs * 1e6;
+		int iterations = 1;
+		while (iterations < MAX_ITERATIONS && TimeIterations(function, iterations) < minrepetitionns) {
+			iterations *= 2;
+		}
+
+		std::vector<double> percall;
+		for (int i = 0; i < settings.repetitions; i++) {
+			percall.push_back(TimeIterations(function, iterations) / iterations);
+		}
+		result.iterations = iterations;
+		result.repetitions = settings.repetitions;
+		result.medianNs = Median(percall);
+		result.minNs = percall.empty() ? 0.0 : *std::min_element(percall.begin(), percall.end());
+		std::vector<double> deviations;
+		for (double ns : percall) {
+			deviations.push_back(std::abs(ns - result.medianNs));
+		}
+		result.madNs = Median(deviations);
+		return result;
+	}
+
+	nlohmann::json ResultsToJson(const std::vector<BenchmarkResult>& results, const BenchmarkSettings& settings) {
+		nlohmann::json j;
+		j["settings"] = {
+			{"warmup_iterations", settings.warmupIterations},
+			{"repetitions", settings.repetitions},
+			{"min_repetition_ms", settings.minRepetitionMs}
+		};
+		nlohmann::json benchmarks = nlohmann::json::array();
+		for (const auto& result : results) {
+			benchmarks.push_back({
+				{"name", result.name},
+				{"input", result.input},
+				{"iterations", result.iterations},
+				{"repetitions", result.repetitions},
+				{"median_ns", result.medianNs},
+				{"mad_ns", result.madNs},
+				{"min_ns", result.minNs}
+			});
+		}
+		j["benchmarks"] = benchmarks;
+		return j;
+	}
+
+	bool ReadBaseline(const std::filesystem::path& baselinePath, std::vector<BenchmarkResult>& baseline) {
+		std::ifstream file(baselinePath);
+		if (!file.is_open()) {
+			std::cerr << "Error opening the baseline file: " << baselinePath.string() << std::endl;
+			return false;
+		}
+		nlohmann::json j = nlohmann::json::parse(file, nullptr, false);
+		if (j.is_discarded() || !j.contains("benchmarks")) {
+			std::cerr << "Invalid baseline file: " << baselinePath.string() << std::endl;
+			return false;
+		}
+		for (const auto& benchmark : j["benchmarks"]) {
+			BenchmarkResult result;
+			result.name = benchmark.value("name", "");
+			result.input = benchmark.value("input", "");
+			result.iterations = benchmark.value("iterations", 0);
+			result.repetitions = benchmark.value("repetitions", 0);
+			result.medianNs = benchmark.value("median_ns", 0.0);
+			result.madNs = benchmark.value("mad_ns", 0.0);
+			result.minNs = benchmark.value("min_ns", 0.0);
+			baseline.push_back(result);
+		}
+		return true;
+	}
+
+	int CompareToBaseline(const std::vector<BenchmarkResult>& results,
+		const std::vector<BenchmarkResult>& baseline, double tolerance, std::ostream& out) {
+		std::map<std::string, const BenchmarkResult*> baselinebykey;
+		for (const auto& result : baseline) {
+			baselinebykey[result.GetKey()] = &result;
+		}
+
+		int regressions = 0;
+		out << std::left << std::setw(36) << "benchmark"
+			<< std::setw(28) << "input"
+			<< std::right << std::setw(14) << "baseline"
+			<< std::setw(14) << "current"
+			<< std::setw(10) << "change" << "\n";
+		for (const auto& result : results) {
+			auto match = baselinebykey.find(result.GetKey());
+			if (match == baselinebykey.end()) {
+				out << std::left << std::setw(36) << result.name << std::setw(28) << result.input
+					<< std::right << std::setw(14) << "-" << std::setw(14) << FormatNs(result.medianNs)
+					<< std::setw(10) << "new" << "\n";
+				continue;
+			}
+			const BenchmarkResult& previous = *match->second;
+			double change = previous.medianNs > 0 ? result.medianNs / previous.medianNs - 1.0 : 0.0;
+			// A slowdown within the noise of either run is not reported as a regression.
+			bool regressed = change > tolerance &&
+				result.medianNs - previous.medianNs > 3.0 * (result.madNs + previous.madNs);
+			if (regressed) regressions++;
+			std::ostringstream percent;
+			percent << std::showpos << std::fixed << std::setprecision(1) << 100.0 * change << "%";
+			out << std::left << std::setw(36) << result.name << std::setw(28) << result.input
+				<< std::right << std::setw(14) << FormatNs(previous.medianNs)
+				<< std::setw(14) << FormatNs(result.medianNs)
+				<< std::setw(10) << percent.str() << (regressed ? "  REGRESSION" : "") << "\n";
+		}
+		return regressions;
+	}
+
+	void PrintBenchmarkResults(const std::vector<BenchmarkResult>& results, std::ostream& out) {
+		out << std::left << std::setw(36) << "benchmark"
+			<< std::setw(28) << "input"
+			<< std::right << std::setw(14) << "median"
+			<< std::setw(14) << "mad"
+			<< std::setw(12) << "iterations" << "\n";
+		for (const auto& result : results) {
+			out << std::left << std::setw(36) << result.name << std::setw(28) << result.input
+				<< std::right << std::setw(14) << FormatNs(result.medianNs)
+				<< std::setw(14) << FormatNs(result.madNs)
+				<< std::setw(12) << result.iterations << "\n";
+		}
+	}
+} // namespace textextract
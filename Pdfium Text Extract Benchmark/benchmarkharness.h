@@ -0,0 +1,106 @@
+#ifndef BENCHMARK_HARNESS
+#define BENCHMARK_HARNESS
+
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace textextract {
+	/**
+	* @brief Timing of one benchmark, summarized over every repetition.
+	*/
+	struct BenchmarkResult {
+		// Name of the benchmark, such as stage/GetWordTokens or document/end_to_end.
+		std::string name;
+		// Input the benchmark ran on, such as a document name and page.
+		std::string input;
+		// Number of calls timed in each repetition.
+		int iterations = 0;
+		// Number of timed repetitions.
+		int repetitions = 0;
+		// Median time of a call over the repetitions, in nanoseconds.
+		double medianNs = 0.0;
+		// Median absolute deviation of the time of a call, in nanoseconds.
+		double madNs = 0.0;
+		// Fastest repetition's time of a call, in nanoseconds.
+		double minNs = 0.0;
+
+		/**
+		* Get the key that results are matched to baseline results by.
+		*
+		* @returns The name and input of the benchmark.
+		*/
+		std::string GetKey() const { return name + "|" + input; }
+	};
+
+	/**
+	* @brief Settings controlling how long and how often each benchmark runs.
+	*/
+	struct BenchmarkSettings {
+		// Untimed calls made before timing, to warm caches and allocators.
+		int warmupIterations = 2;
+		// Number of timed repetitions, summarized by their median.
+		int repetitions = 15;
+		// Shortest time a repetition should take, the number of calls per repetition is
+		// raised until it is reached so that clock resolution does not matter.
+		double minRepetitionMs = 20.0;
+	};
+
+	/**
+	* Time a function, calling it enough times per repetition to reach the minimum
+	* repetition time, and summarize the repetitions by their median and spread.
+	*
+	* @param name Name of the benchmark.
+	* @param input Input the benchmark runs on.
+	* @param settings Warmup, repetition and timing settings.
+	* @param function The function to time.
+	*
+	* @returns The timing of the function.
+	*/
+	BenchmarkResult RunBenchmark(const std::string& name, const std::string& input,
+		const BenchmarkSettings& settings, const std::function<void()>& function);
+	/**
+	* Convert benchmark results to JSON, in the format read by ReadBaseline.
+	*
+	* @param results Results to convert.
+	* @param settings Settings the results were taken with.
+	*
+	* @returns The results as a JSON object.
+	*/
+	nlohmann::json ResultsToJson(const std::vector<BenchmarkResult>& results, const BenchmarkSettings& settings);
+	/**
+	* Read benchmark results previously written with ResultsToJson.
+	*
+	* @param baselinePath Path to the baseline JSON file.
+	* @param baseline Set to the results in the file.
+	*
+	* @returns True if the file was read.
+	*/
+	bool ReadBaseline(const std::filesystem::path& baselinePath, std::vector<BenchmarkResult>& baseline);
+	/**
+	* Compare results to a baseline and write a table of the change of each benchmark.
+	* A benchmark has regressed when its median is slower than the baseline by more than
+	* the tolerance and by more than the combined spread of both measurements.
+	*
+	* @param results Results of the current run.
+	* @param baseline Results to compare against.
+	* @param tolerance Allowed slowdown as a fraction, such as 0.1 for 10%.
+	* @param out Stream to write the comparison to.
+	*
+	* @returns The number of benchmarks that regressed.
+	*/
+	int CompareToBaseline(const std::vector<BenchmarkResult>& results,
+		const std::vector<BenchmarkResult>& baseline, double tolerance, std::ostream& out);
+	/**
+	* Write benchmark results as a table.
+	*
+	* @param results Results to write.
+	* @param out Stream to write the table to.
+	*/
+	void PrintBenchmarkResults(const std::vector<BenchmarkResult>& results, std::ostream& out);
+} // namespace textextract
+#endif
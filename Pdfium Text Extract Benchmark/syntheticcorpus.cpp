@@ -0,0 +1,139 @@
+#include "syntheticcorpus.h"
+
+#include "pdfium/cpp/fpdf_scopers.h"
+#include "pdfium/fpdf_edit.h"
+#include "pdfium/fpdf_save.h"
+#include "load_support.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace textextract {
+	namespace {
+		// Largest margin of a page, in points. Small pages get a tenth of their width.
+		const float MAX_MARGIN = 72.0f;
+		// Rough width of a character relative to the font size, for line breaking.
+		const float CHARACTER_WIDTH = 0.5f;
+		// Distance between lines relative to the font size.
+		const float LINE_SPACING = 1.2f;
+		// Average length of a random word, with the space that follows it.
+		const float AVERAGE_WORD_LENGTH = 6.5f;
+		// Range of font sizes used to fit the words to the page, in points.
+		const float MIN_FIT_FONT_SIZE = 0.5f;
+		const float MAX_FIT_FONT_SIZE = 12.0f;
+		// Standard fonts, which every PDF reader has, so that no fonts are embedded.
+		const char* STANDARD_FONTS[] = {
+			"Helvetica", "Times-Roman", "Courier",
+			"Helvetica-Bold", "Times-Bold", "Courier-Bold",
+			"Helvetica-Oblique", "Times-Italic", "Courier-Oblique",
+			"Helvetica-BoldOblique", "Times-BoldItalic", "Courier-BoldOblique" };
+		const int STANDARD_FONT_COUNT = sizeof(STANDARD_FONTS) / sizeof(STANDARD_FONTS[0]);
+
+		std::wstring RandomWord(std::mt19937& random) {
+			std::uniform_int_distribution<int> length(1, 10);
+			std::uniform_int_distribution<int> letter(0, 25);
+			std::wstring word;
+			int wordlength = length(random);
+			for (int i = 0; i < wordlength; i++) {
+				word += static_cast<wchar_t>(L'a' + letter(random));
+			}
+			return word;
+		}
+
+		bool AddText(FPDF_DOCUMENT doc, FPDF_PAGE page, const std::wstring& text, const char* font,
+			float fontSize, double a, double b, double c, double d, double x, double y, unsigned int gray) {
+			FPDF_PAGEOBJECT textobject = FPDFPageObj_NewTextObj(doc, font, fontSize);
+			if (!textobject) return false;
+			auto widetext = GetFPDFWideString(text);
+			if (!FPDFText_SetText(textobject, widetext.get())) {
+				FPDFPageObj_Destroy(textobject);
+				return false;
+			}
+			FPDFPageObj_SetFillColor(textobject, gray, gray, gray, 255);
+			FPDFPageObj_Transform(textobject, a, b, c, d, x, y);
+			FPDFPage_InsertObject(page, textobject);
+			return true;
+		}
+
+		// The font size that fills the text area of the page with the spec's words.
+		float FitFontSize(float textWidth, float textHeight, int words) {
+			float characters = std::max(1.0f, words * AVERAGE_WORD_LENGTH);
+			float fontsize = std::sqrt(textWidth * textHeight / (characters * CHARACTER_WIDTH * LINE_SPACING));
+			return std::clamp(fontsize, MIN_FIT_FONT_SIZE, MAX_FIT_FONT_SIZE);
+		}
+
+		bool AddPage(FPDF_DOCUMENT doc, int index, const SyntheticDocumentSpec& spec, std::mt19937& random) {
+			PageType pagetype = spec.pageTypes.empty() ?
+				PageType::ANSI_LETTER : spec.pageTypes[index % spec.pageTypes.size()];
+			PageDimensions pagedims = GetPageTypeDimensions(pagetype);
+			ScopedFPDFPage page(FPDFPage_New(doc, index, pagedims.width, pagedims.height));
+			if (!page) return false;
+			if (!spec.rotations.empty()) {
+				FPDFPage_SetRotation(page.get(), static_cast<int>(spec.rotations[index % spec.rotations.size()]));
+			}
+
+			float margin = std::min(MAX_MARGIN, 0.1f * std::min(pagedims.width, pagedims.height));
+			float textwidth = pagedims.width - 2 * margin;
+			float textheight = pagedims.height - 2 * margin;
+			float fontsize = spec.fontSize > 0 ?
+				spec.fontSize : FitFontSize(textwidth, textheight, spec.wordsPerPage);
+			float lineheight = fontsize * LINE_SPACING;
+			size_t linecharacters = std::max<size_t>(1, static_cast<size_t>(textwidth / (fontsize * CHARACTER_WIDTH)));
+			int fontcount = std::clamp(spec.fontCount, 1, STANDARD_FONT_COUNT);
+			std::uniform_int_distribution<int> fontchoice(0, fontcount - 1);
+
+			float y = pagedims.height - margin;
+			std::wstring line;
+			for (int i = 0; i < spec.wordsPerPage && y > margin; i++) {
+				std::wstring word = RandomWord(random);
+				if (!line.empty() && line.size() + word.size() + 1 > linecharacters) {
+					if (!AddText(doc, page.get(), line, STANDARD_FONTS[fontchoice(random)], fontsize,
+						1, 0, 0, 1, margin, y, 0)) return false;
+					y -= lineheight;
+					line.clear();
+				}
+				line += line.empty() ? word : L" " + word;
+			}
+			if (!line.empty() && y > margin) {
+				if (!AddText(doc, page.get(), line, STANDARD_FONTS[fontchoice(random)], fontsize,
+					1, 0, 0, 1, margin, y, 0)) return false;
+			}
+			if (spec.watermark) {
+				// Rotated 45 degrees and centered on the page, scaled to the page width.
+				const double DIAGONAL = 0.70710678;
+				const std::wstring WATERMARK = L"CONFIDENTIAL";
+				float watermarksize = 72.0f * pagedims.width / 612.0f;
+				double halflength = WATERMARK.size() * watermarksize * 0.6 / 2.0;
+				double x = pagedims.width / 2.0 - halflength * DIAGONAL;
+				double y = pagedims.height / 2.0 - halflength * DIAGONAL;
+				if (!AddText(doc, page.get(), WATERMARK, "Helvetica", watermarksize,
+					DIAGONAL, DIAGONAL, -DIAGONAL, DIAGONAL, x, y, 200)) return false;
+			}
+			return FPDFPage_GenerateContent(page.get());
+		}
+	} // namespace
+
+	bool WriteSyntheticDocument(const SyntheticDocumentSpec& spec, const std::filesystem::path& pdfPath) {
+		ScopedFPDFDocument doc(FPDF_CreateNewDocument());
+		if (!doc) return false;
+		std::mt19937 random(spec.seed);
+		for (int i = 0; i < spec.pageCount; i++) {
+			if (!AddPage(doc.get(), i, spec, random)) {
+				std::cerr << "Error generating page " << i + 1 << " of " << spec.name << std::endl;
+				return false;
+			}
+		}
+		DocSaver saver;
+		if (!FPDF_SaveAsCopy(doc.get(), &saver, FPDF_NO_INCREMENTAL)) return false;
+		std::ofstream file(pdfPath, std::ios::binary);
+		if (!file.is_open()) {
+			std::cerr << "Error opening the document file: " << pdfPath.string() << std::endl;
+			return false;
+		}
+		file.write(saver.GetString().data(), saver.GetString().size());
+		return file.good();
+	}
+} // namespace textextract
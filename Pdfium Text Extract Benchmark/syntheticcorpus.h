@@ -0,0 +1,48 @@
+#ifndef SYNTHETIC_CORPUS
+#define SYNTHETIC_CORPUS
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "viewutils.h"
+
+namespace textextract {
+	/**
+	* @brief Description of a generated text document. The same description always
+	* produces the same page content, so benchmarks on it can be compared between runs.
+	*/
+	struct SyntheticDocumentSpec {
+		// Name the document is written and reported under.
+		std::string name = "synthetic";
+		// Number of pages in the document.
+		int pageCount = 4;
+		// Number of words written to each page.
+		int wordsPerPage = 400;
+		// Font size of the body text in points, 0 to fit every word on the page.
+		float fontSize = 10.0f;
+		// Number of different standard fonts the lines of text are set in, from 1 to 12.
+		int fontCount = 1;
+		// Page types of the pages, repeated in order over the pages of the document.
+		std::vector<PageType> pageTypes = { PageType::ANSI_LETTER };
+		// Rotations of the pages, repeated in order over the pages of the document.
+		std::vector<PageRotation> rotations = { PageRotation::NO_ROTATION };
+		// Whether or not a large diagonal watermark is drawn over each page.
+		bool watermark = true;
+		// Seed of the random words and fonts.
+		uint32_t seed = 1;
+	};
+
+	/**
+	* Generate a PDF of lines of random words described by the spec and save it.
+	* The pdfium library has to be initialized before the document is generated.
+	*
+	* @param spec Description of the document.
+	* @param pdfPath Path to save the document to.
+	*
+	* @returns True if the document was generated and saved.
+	*/
+	bool WriteSyntheticDocument(const SyntheticDocumentSpec& spec, const std::filesystem::path& pdfPath);
+} // namespace textextract
+#endif
@@ -0,0 +1,163 @@
+#include "syntheticcorpus.h"
+
+#include "pdfium/fpdfview.h"
+#include "load_support.h"
+
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+#undef snprintf
+#include <boost/program_options.hpp>
+
+using namespace textextract;
+namespace po = boost::program_options;
+
+namespace {
+	// Parse a comma separated list of whole numbers, such as 10,100,1000.
+	bool ParseIntList(const std::string& list, std::vector<int>& values) {
+		for (const auto& item : StringSplit(list, ',')) {
+			try {
+				values.push_back(std::stoi(item));
+			}
+			catch (const std::exception&) {
+				return false;
+			}
+		}
+		return !values.empty();
+	}
+
+	bool ParsePageTypes(const std::string& list, std::vector<PageType>& pageTypes) {
+		for (const auto& item : StringSplit(list, ',')) {
+			PageType pagetype;
+			if (!ParsePageType(item, pagetype)) return false;
+			pageTypes.push_back(pagetype);
+		}
+		return !pageTypes.empty();
+	}
+
+	// Rotations are given in clockwise degrees.
+	bool ParseRotations(const std::string& list, std::vector<PageRotation>& rotations) {
+		std::vector<int> degrees;
+		if (!ParseIntList(list, degrees)) return false;
+		for (int degree : degrees) {
+			if (degree % 90 != 0 || degree < 0 || degree > 270) return false;
+			rotations.push_back(static_cast<PageRotation>(degree / 90));
+		}
+		return true;
+	}
+
+	nlohmann::json SpecToJson(const SyntheticDocumentSpec& spec, const std::string& file) {
+		nlohmann::json j;
+		j["file"] = file;
+		j["seed"] = spec.seed;
+		j["pages"] = spec.pageCount;
+		j["words_per_page"] = spec.wordsPerPage;
+		j["font_size"] = spec.fontSize;
+		j["fonts"] = spec.fontCount;
+		j["watermark"] = spec.watermark;
+		nlohmann::json pagetypes = nlohmann::json::array();
+		for (PageType pagetype : spec.pageTypes) {
+			pagetypes.push_back(PageTypeToString(pagetype));
+		}
+		j["page_types"] = pagetypes;
+		nlohmann::json rotations = nlohmann::json::array();
+		for (PageRotation rotation : spec.rotations) {
+			rotations.push_back(static_cast<int>(rotation) * 90);
+		}
+		j["rotations"] = rotations;
+		return j;
+	}
+} // namespace
+
+int main(int argc, char* argv[]) {
+	po::options_description desc("Options");
+	desc.add_options()
+		("help,h", "Produce help message.")
+		("outputlocation,o", po::value<std::string>()->default_value(""), "Directory to write the generated PDFs and corpus.json to.")
+		("seed", po::value<uint32_t>()->default_value(1), "Seed of the corpus, the same seed and options generate the same pages.")
+		("pages", po::value<std::string>()->default_value("10"), "Comma separated page counts to generate documents for.")
+		("words", po::value<std::string>()->default_value("400"), "Comma separated words per page to generate documents for, such as 10,1000,100000.")
+		("fonts", po::value<std::string>()->default_value("1"), "Comma separated numbers of standard fonts used in a document, from 1 to 12.")
+		("watermarks", po::value<std::string>()->default_value("1"), "Comma separated watermark settings, 0 for none and 1 for a diagonal overlay.")
+		("fontsize", po::value<float>()->default_value(0.0f), "Font size of the body text in points, 0 fits the words to each page.")
+		("pagetypes", po::value<std::string>()->default_value("letter"), "Page types repeated over the pages of each document, such as letter,a4,legal.")
+		("rotations", po::value<std::string>()->default_value("0"), "Clockwise page rotations in degrees repeated over the pages of each document, such as 0,90.");
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if (vm.count("help") || vm["outputlocation"].as<std::string>().empty()) {
+		std::cout << desc << "\n";
+		return 1;
+	}
+
+	std::vector<int> pagecounts, wordcounts, fontcounts, watermarks;
+	if (!ParseIntList(vm["pages"].as<std::string>(), pagecounts) ||
+		!ParseIntList(vm["words"].as<std::string>(), wordcounts) ||
+		!ParseIntList(vm["fonts"].as<std::string>(), fontcounts) ||
+		!ParseIntList(vm["watermarks"].as<std::string>(), watermarks)) {
+		std::cerr << "Invalid number list in pages, words, fonts or watermarks." << std::endl;
+		return EXIT_FAILURE;
+	}
+	SyntheticDocumentSpec base;
+	base.fontSize = vm["fontsize"].as<float>();
+	base.pageTypes.clear();
+	base.rotations.clear();
+	if (!ParsePageTypes(vm["pagetypes"].as<std::string>(), base.pageTypes)) {
+		std::cerr << "Invalid page types: " << vm["pagetypes"].as<std::string>() << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (!ParseRotations(vm["rotations"].as<std::string>(), base.rotations)) {
+		std::cerr << "Invalid rotations: " << vm["rotations"].as<std::string>() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::filesystem::path outputpath(vm["outputlocation"].as<std::string>());
+	std::filesystem::create_directories(outputpath);
+	uint32_t seed = vm["seed"].as<uint32_t>();
+	nlohmann::json manifest;
+	manifest["seed"] = seed;
+	nlohmann::json documents = nlohmann::json::array();
+
+	FPDF_InitLibrary();
+	int failures = 0;
+	// Every combination of the swept values is one document, each with its own seed
+	// derived from the corpus seed, so that a document does not change when others are added.
+	for (int pagecount : pagecounts) {
+		for (int wordcount : wordcounts) {
+			for (int fontcount : fontcounts) {
+				for (int watermark : watermarks) {
+					SyntheticDocumentSpec spec = base;
+					spec.pageCount = pagecount;
+					spec.wordsPerPage = wordcount;
+					spec.fontCount = fontcount;
+					spec.watermark = watermark != 0;
+					spec.seed = seed ^ (static_cast<uint32_t>(pagecount) * 2654435761u) ^
+						(static_cast<uint32_t>(wordcount) * 40503u) ^
+						(static_cast<uint32_t>(fontcount) << 24) ^ (static_cast<uint32_t>(watermark) << 31);
+					spec.name = "synthetic_p" + std::to_string(pagecount) + "_w" + std::to_string(wordcount) +
+						"_f" + std::to_string(fontcount) + "_wm" + std::to_string(watermark);
+					std::string file = spec.name + ".pdf";
+					std::cout << "generating " << file << std::endl;
+					if (!WriteSyntheticDocument(spec, outputpath / file)) {
+						std::cerr << "Failed to generate " << file << std::endl;
+						failures++;
+						continue;
+					}
+					documents.push_back(SpecToJson(spec, file));
+				}
+			}
+		}
+	}
+	FPDF_DestroyLibrary();
+
+	manifest["documents"] = documents;
+	std::ofstream manifestfile(outputpath / "corpus.json");
+	if (!manifestfile.is_open()) {
+		std::cerr << "Error opening the corpus manifest." << std::endl;
+		return EXIT_FAILURE;
+	}
+	manifestfile << manifest.dump(4);
+	return failures > 0 ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,122 @@
+#ifndef BOUNDED_QUEUE
+#define BOUNDED_QUEUE
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace textextract {
+	/**
+	* @brief How full a bounded queue ran and how long its producers and consumers waited on it.
+	*/
+	struct QueueStats {
+		size_t capacity = 0;
+		// Most items held at once.
+		size_t maxDepth = 0;
+		// Number of items pushed.
+		uint64_t pushes = 0;
+		// Sum of the depth of the queue after each push, for the mean depth.
+		uint64_t depthSum = 0;
+		// Time producers spent waiting for room, and consumers waiting for an item, in milliseconds.
+		double pushWaitMs = 0.0;
+		double popWaitMs = 0.0;
+	};
+
+	/**
+	* @brief A queue holding at most a fixed number of items, handing items from the threads
+	* of one pipeline stage to the next. Push waits while the queue is full, so a slow stage
+	* holds back the stages feeding it instead of letting pages pile up in memory.
+	*/
+	template <typename T>
+	class BoundedQueue {
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		std::mutex mMutex;
+		std::condition_variable mNotFull;
+		std::condition_variable mNotEmpty;
+		std::deque<T> mItems;
+		size_t mCapacity;
+		bool mClosed = false;
+		QueueStats mStats;
+
+		static double MillisecondsSince(Clock::time_point start) {
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+	public:
+		explicit BoundedQueue(size_t capacity) : mCapacity(capacity > 0 ? capacity : 1) {
+			mStats.capacity = mCapacity;
+		}
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+		/**
+		* Add an item, waiting while the queue is full.
+		*
+		* @param item The item to add.
+		*
+		* @returns False if the queue was closed, in which case the item was not added.
+		*/
+		bool Push(T item) {
+			std::unique_lock<std::mutex> lock(mMutex);
+			if (mItems.size() >= mCapacity && !mClosed) {
+				auto start = Clock::now();
+				mNotFull.wait(lock, [this]() { return mItems.size() < mCapacity || mClosed; });
+				mStats.pushWaitMs += MillisecondsSince(start);
+			}
+			if (mClosed) return false;
+			mItems.push_back(std::move(item));
+			mStats.pushes++;
+			mStats.depthSum += mItems.size();
+			if (mItems.size() > mStats.maxDepth) mStats.maxDepth = mItems.size();
+			lock.unlock();
+			mNotEmpty.notify_one();
+			return true;
+		}
+		/**
+		* Remove the oldest item, waiting while the queue is empty.
+		*
+		* @param item Set to the removed item.
+		*
+		* @returns False once the queue is closed and empty.
+		*/
+		bool Pop(T& item) {
+			std::unique_lock<std::mutex> lock(mMutex);
+			if (mItems.empty() && !mClosed) {
+				auto start = Clock::now();
+				mNotEmpty.wait(lock, [this]() { return !mItems.empty() || mClosed; });
+				mStats.popWaitMs += MillisecondsSince(start);
+			}
+			if (mItems.empty()) return false;
+			item = std::move(mItems.front());
+			mItems.pop_front();
+			lock.unlock();
+			mNotFull.notify_one();
+			return true;
+		}
+		/**
+		* Stop accepting items. Items already queued can still be removed.
+		*/
+		void Close() {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mClosed = true;
+			}
+			mNotFull.notify_all();
+			mNotEmpty.notify_all();
+		}
+		/**
+		* Get the depth and wait times of the queue so far.
+		*
+		* @returns The queue stats.
+		*/
+		QueueStats GetStats() {
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mStats;
+		}
+	};
+} // namespace textextract
+#endif
@@ -0,0 +1,145 @@
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#define fileno _fileno
+#define fsync _commit
+#else
+#include <unistd.h>
+#endif
+
+namespace textextract {
+	namespace {
+		const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+		const uint64_t FNV_PRIME = 1099511628211ULL;
+	} // namespace
+
+	bool HashFile(const std::filesystem::path& path, uint64_t& hash) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return false;
+		hash = FNV_OFFSET_BASIS;
+		std::vector<char> buffer(1 << 16);
+		while (file) {
+			file.read(buffer.data(), buffer.size());
+			std::streamsize count = file.gcount();
+			for (std::streamsize i = 0; i < count; i++) {
+				hash ^= static_cast<unsigned char>(buffer[i]);
+				hash *= FNV_PRIME;
+			}
+		}
+		return file.eof();
+	}
+
+	uint64_t HashString(const std::string& text) {
+		uint64_t hash = FNV_OFFSET_BASIS;
+		for (char c : text) {
+			hash ^= static_cast<unsigned char>(c);
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	CheckpointJournal::~CheckpointJournal() {
+		if (mFile) {
+			Sync();
+			fclose(mFile);
+		}
+	}
+
+	void CheckpointJournal::Load(const std::filesystem::path& path) {
+		std::ifstream file(path);
+		std::string record;
+		while (std::getline(file, record)) {
+			uint64_t documenthash = 0;
+			uint64_t checksum = 0;
+			uint64_t runkey = 0;
+			int pagenumber = 0;
+			// Page records without a fingerprint, which have a field less, are ignored and their pages processed again.
+			if (std::count(record.begin(), record.end(), ' ') == 4 && sscanf(record.c_str(),
+				"P %" SCNx64 " %" SCNx64 " %d %" SCNx64, &documenthash, &runkey, &pagenumber, &checksum) == 4) {
+				mPages[{ documenthash, runkey }][pagenumber] = checksum;
+			}
+			// Document records without a fingerprint are ignored, and their pages checked one by one.
+			else if (sscanf(record.c_str(), "D %" SCNx64 " %" SCNx64, &documenthash, &runkey) == 2) {
+				mDocuments.insert({ documenthash, runkey });
+			}
+		}
+	}
+
+	bool CheckpointJournal::Open(const std::filesystem::path& path, int syncInterval) {
+		mSyncInterval = std::max(syncInterval, 1);
+		bool exists = std::filesystem::exists(path);
+		if (exists) Load(path);
+		mFile = fopen(path.string().c_str(), "ab");
+		if (!mFile) {
+			std::cerr << "Error opening the checkpoint journal: " << path.string() << std::endl;
+			return false;
+		}
+		// Start on a new line if the last record was torn, so that it is not joined to the next.
+		if (exists && std::filesystem::file_size(path) > 0) {
+			std::ifstream last(path, std::ios::binary);
+			last.seekg(-1, std::ios::end);
+			if (last.get() != '\n') fputc('\n', mFile);
+		}
+		return true;
+	}
+
+	bool CheckpointJournal::IsDocumentComplete(uint64_t documentHash, uint64_t runKey) const {
+		return mDocuments.count({ documentHash, runKey }) > 0;
+	}
+
+	bool CheckpointJournal::IsPageComplete(uint64_t documentHash, uint64_t runKey, int pageNumber,
+		const std::filesystem::path& outputPath) const {
+		auto document = mPages.find({ documentHash, runKey });
+		if (document == mPages.end()) return false;
+		auto page = document->second.find(pageNumber);
+		if (page == document->second.end()) return false;
+		uint64_t checksum = 0;
+		return HashFile(outputPath, checksum) && checksum == page->second;
+	}
+
+	bool CheckpointJournal::RecordPage(uint64_t documentHash, uint64_t runKey, int pageNumber,
+		const std::filesystem::path& outputPath) {
+		uint64_t checksum = 0;
+		if (!HashFile(outputPath, checksum)) return false;
+		char record[80];
+		snprintf(record, sizeof(record), "P %016" PRIx64 " %016" PRIx64 " %d %016" PRIx64 "\n",
+			documentHash, runKey, pageNumber, checksum);
+		if (!Append(record)) return false;
+		mPages[{ documentHash, runKey }][pageNumber] = checksum;
+		return true;
+	}
+
+	bool CheckpointJournal::RecordDocument(uint64_t documentHash, uint64_t runKey) {
+		char record[48];
+		snprintf(record, sizeof(record), "D %016" PRIx64 " %016" PRIx64 "\n", documentHash, runKey);
+		if (!Append(record)) return false;
+		mDocuments.insert({ documentHash, runKey });
+		return true;
+	}
+
+	bool CheckpointJournal::Append(const std::string& record) {
+		if (!mFile) return false;
+		// Each record is flushed so that it survives the process being killed, while
+		// syncing to disk, which is far slower, is batched.
+		if (fwrite(record.data(), 1, record.size(), mFile) != record.size() || fflush(mFile) != 0) {
+			std::cerr << "Error writing to the checkpoint journal." << std::endl;
+			return false;
+		}
+		if (++mUnsynced >= mSyncInterval) Sync();
+		return true;
+	}
+
+	void CheckpointJournal::Sync(bool force) {
+		if (!mFile || (mUnsynced == 0 && !force)) return;
+		fflush(mFile);
+		fsync(fileno(mFile));
+		mUnsynced = 0;
+	}
+} // namespace textextract
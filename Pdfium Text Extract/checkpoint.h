@@ -0,0 +1,134 @@
+#ifndef CHECKPOINT
+#define CHECKPOINT
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace textextract {
+	/**
+	* Compute the 64 bit FNV-1a hash of a file's contents.
+	*
+	* @param path Path of the file to hash.
+	* @param hash Set to the hash of the file.
+	*
+	* @returns True if the file was read.
+	*/
+	bool HashFile(const std::filesystem::path& path, uint64_t& hash);
+	/**
+	* Compute the 64 bit FNV-1a hash of a string.
+	*
+	* @param text The string to hash.
+	*
+	* @returns The hash of the string.
+	*/
+	uint64_t HashString(const std::string& text);
+
+	/**
+	* @brief Append-only journal of the pages whose output has been written, so that a
+	* restarted batch can skip the work that was already completed.
+	*
+	* Documents are identified by the hash of their contents, so renamed or moved files are
+	* still recognised. Each page is recorded with a fingerprint of the options and output
+	* location it was written with, and the checksum of its output file. A page is only
+	* skipped by a run with the same fingerprint, while its output file still matches that
+	* checksum. Once every page of a document is written, the document is recorded as
+	* complete along with the fingerprint of the run, which also covers the page set, and a
+	* run with the same fingerprint skips it without loading it.
+	*
+	* Records are flushed to the operating system as they are written, and synced to disk
+	* in batches. A record torn by a crash is ignored when the journal is read back, and
+	* its pages are processed again.
+	*/
+	class CheckpointJournal {
+	private:
+		// Output checksums of the completed pages of documents, keyed by document hash and
+		// page fingerprint, then by one based page number.
+		std::map<std::pair<uint64_t, uint64_t>, std::unordered_map<int, uint64_t>> mPages;
+		// Hashes of the documents that are complete, each with the fingerprint of the run
+		// that completed it.
+		std::set<std::pair<uint64_t, uint64_t>> mDocuments;
+		FILE* mFile = nullptr;
+		// Number of records written between syncs to disk.
+		int mSyncInterval = 64;
+		// Number of records written since the last sync.
+		int mUnsynced = 0;
+
+		// Read back the records of an existing journal.
+		void Load(const std::filesystem::path& path);
+		// Write a single record, syncing once the sync interval is reached.
+		bool Append(const std::string& record);
+
+	public:
+		CheckpointJournal() = default;
+		CheckpointJournal(const CheckpointJournal&) = delete;
+		CheckpointJournal& operator=(const CheckpointJournal&) = delete;
+		~CheckpointJournal();
+		/**
+		* Read the records of the journal at path, if any, and open it for appending.
+		*
+		* @param path Path of the journal file.
+		* @param syncInterval Number of records written between syncs to disk.
+		*
+		* @returns True if the journal was opened.
+		*/
+		bool Open(const std::filesystem::path& path, int syncInterval);
+		/**
+		* Check whether every page of a document was already written with the same options
+		* to the same location.
+		*
+		* @param documentHash Hash of the document's contents.
+		* @param runKey Fingerprint of the page set, options and output location.
+		*
+		* @returns True if the document is complete.
+		*/
+		bool IsDocumentComplete(uint64_t documentHash, uint64_t runKey) const;
+		/**
+		* Check whether the output of a page was written with the same options to the same
+		* location, and is unchanged since.
+		*
+		* @param documentHash Hash of the document's contents.
+		* @param runKey Fingerprint of the options and output location.
+		* @param pageNumber One based page number.
+		* @param outputPath Path of the page's output file.
+		*
+		* @returns True if the page was recorded and its output matches the recorded checksum.
+		*/
+		bool IsPageComplete(uint64_t documentHash, uint64_t runKey, int pageNumber,
+			const std::filesystem::path& outputPath) const;
+		/**
+		* Record that the output of a page was written.
+		*
+		* @param documentHash Hash of the document's contents.
+		* @param runKey Fingerprint of the options and output location.
+		* @param pageNumber One based page number.
+		* @param outputPath Path of the page's output file, which is checksummed for the record.
+		*
+		* @returns True if the record was written.
+		*/
+		bool RecordPage(uint64_t documentHash, uint64_t runKey, int pageNumber,
+			const std::filesystem::path& outputPath);
+		/**
+		* Record that every page of a document was written.
+		*
+		* @param documentHash Hash of the document's contents.
+		* @param runKey Fingerprint of the page set, options and output location.
+		*
+		* @returns True if the record was written.
+		*/
+		bool RecordDocument(uint64_t documentHash, uint64_t runKey);
+		/**
+		* Sync the records written so far to disk.
+		*
+		* @param force Sync even if this process has written nothing since the last sync, for
+		* records appended by forked workers sharing the journal.
+		*/
+		void Sync(bool force = false);
+	};
+} // namespace textextract
+#endif
@@ -0,0 +1,114 @@
+#include "concurrencycontroller.h"
+
+#include <algorithm>
+
+namespace textextract {
+	namespace {
+		// Samples a number of workers is held for before its throughput is trusted.
+		const int SAMPLES_BEFORE_CHANGE = 2;
+		// Samples after which the throughput measured with one more worker is forgotten,
+		// so that a count that did not pay off earlier is tried again.
+		const int SAMPLES_BEFORE_RETRY = 30;
+		// Gain in pages per second an added worker must bring to be kept.
+		const double MIN_GAIN = 1.05;
+
+		const char* ConcurrencyActionToString(ConcurrencyAction action) {
+			switch (action) {
+			case ConcurrencyAction::RAISE: return "raise";
+			case ConcurrencyAction::LOWER: return "lower";
+			case ConcurrencyAction::SHED: return "shed";
+			default: return "hold";
+			}
+		}
+	} // namespace
+
+	ConcurrencyController::ConcurrencyController(const ConcurrencySettings& settings)
+		: mSettings(settings) {
+		mSettings.maxWorkers = std::max(mSettings.maxWorkers, 1);
+	}
+
+	uint64_t ConcurrencyController::GetReserveBytes() const {
+		return mSettings.memoryCeilingBytes / 10;
+	}
+
+	ConcurrencyAction ConcurrencyController::Decide(const ConcurrencySample& sample, double rate) {
+		uint64_t ceiling = mSettings.memoryCeilingBytes;
+		uint64_t reserve = GetReserveBytes();
+		bool knownavailable = sample.availableBytes > 0;
+		bool critical = sample.usedBytes > ceiling || (knownavailable && sample.availableBytes < reserve / 2);
+		bool high = sample.usedBytes > ceiling / 10 * 9 || (knownavailable && sample.availableBytes < reserve);
+		if (critical && sample.busyWorkers > 1) return ConcurrencyAction::SHED;
+		// A lower only takes effect once a worker finishes its document, until then the
+		// memory is still held and lowering again would only take away more workers.
+		if (sample.busyWorkers > mWorkers) return ConcurrencyAction::HOLD;
+		if ((critical || high) && mWorkers > 1) return ConcurrencyAction::LOWER;
+		if (critical || high) return ConcurrencyAction::HOLD;
+		if (mSamplesAtLevel < SAMPLES_BEFORE_CHANGE) return ConcurrencyAction::HOLD;
+
+		// A worker that did not raise the throughput is taken away again.
+		auto current = mRates.find(mWorkers);
+		auto fewer = mRates.find(mWorkers - 1);
+		if (current != mRates.end() && fewer != mRates.end() && current->second < fewer->second * MIN_GAIN) {
+			return ConcurrencyAction::LOWER;
+		}
+
+		if (mWorkers >= mSettings.maxWorkers || !sample.workPending || sample.busyWorkers < mWorkers) {
+			return ConcurrencyAction::HOLD;
+		}
+		bool fits = sample.usedBytes + mWorkerPeakBytes <= ceiling / 20 * 17 &&
+			(!knownavailable || sample.availableBytes >= mWorkerPeakBytes + reserve);
+		auto more = mRates.find(mWorkers + 1);
+		bool worthtrying = more == mRates.end() || current == mRates.end() ||
+			more->second > current->second * MIN_GAIN;
+		return fits && worthtrying ? ConcurrencyAction::RAISE : ConcurrencyAction::HOLD;
+	}
+
+	ConcurrencyAction ConcurrencyController::Update(const ConcurrencySample& sample) {
+		double rate = sample.intervalMs > 0.0 ? sample.pagesFinished * 1000.0 / sample.intervalMs : 0.0;
+		mWorkerPeakBytes = std::max(sample.largestWorkerBytes, mWorkerPeakBytes - mWorkerPeakBytes / 20);
+		// Throughput only says something about a number of workers while they are all busy.
+		if (sample.busyWorkers >= mWorkers) {
+			auto measured = mRates.find(mWorkers);
+			mRates[mWorkers] = measured == mRates.end() ? rate : (measured->second + rate) / 2.0;
+		}
+		mSamplesAtLevel++;
+		if (mSamplesAtLevel > SAMPLES_BEFORE_RETRY) mRates.erase(mWorkers + 1);
+
+		ConcurrencyAction action = Decide(sample, rate);
+		if (action == ConcurrencyAction::RAISE) {
+			mWorkers++;
+		}
+		else if (action == ConcurrencyAction::LOWER) {
+			mWorkers = std::max(mWorkers - 1, 1);
+		}
+		else if (action == ConcurrencyAction::SHED) {
+			mWorkers = std::max(std::min(mWorkers, sample.busyWorkers) - 1, 1);
+		}
+		if (action != ConcurrencyAction::HOLD) {
+			mSamplesAtLevel = 0;
+			ConcurrencyDecision decision;
+			decision.action = action;
+			decision.workers = mWorkers;
+			decision.sample = sample;
+			decision.pagesPerSecond = rate;
+			mDecisions.push_back(decision);
+		}
+		return action;
+	}
+
+	nlohmann::json ConcurrencyController::DecisionsToJson() const {
+		nlohmann::json decisions = nlohmann::json::array();
+		for (const auto& decision : mDecisions) {
+			nlohmann::json j;
+			j["time_ms"] = decision.sample.timeMs;
+			j["action"] = ConcurrencyActionToString(decision.action);
+			j["workers"] = decision.workers;
+			j["used_bytes"] = decision.sample.usedBytes;
+			j["largest_worker_bytes"] = decision.sample.largestWorkerBytes;
+			j["available_bytes"] = decision.sample.availableBytes;
+			j["pages_per_second"] = decision.pagesPerSecond;
+			decisions.push_back(j);
+		}
+		return decisions;
+	}
+} // namespace textextract
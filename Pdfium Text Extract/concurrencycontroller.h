@@ -0,0 +1,119 @@
+#ifndef CONCURRENCY_CONTROLLER
+#define CONCURRENCY_CONTROLLER
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace textextract {
+	/**
+	* @brief Memory ceiling and worker bounds the concurrency controller works within.
+	*/
+	struct ConcurrencySettings {
+		// Memory the supervisor and its workers may use together, in bytes.
+		uint64_t memoryCeilingBytes = 0;
+		// Most workers that may be active at once.
+		int maxWorkers = 1;
+	};
+
+	/**
+	* @brief Memory use and throughput of the workers over one control interval.
+	*/
+	struct ConcurrencySample {
+		// Time since the run started, in milliseconds.
+		double timeMs = 0.0;
+		// Length of the interval the sample covers, in milliseconds.
+		double intervalMs = 0.0;
+		// Resident memory of the supervisor and every worker together, in bytes.
+		uint64_t usedBytes = 0;
+		// Resident memory of the largest busy worker, in bytes.
+		uint64_t largestWorkerBytes = 0;
+		// Memory the system can still hand out, in bytes, 0 if unknown.
+		uint64_t availableBytes = 0;
+		// Pages finished during the interval.
+		int pagesFinished = 0;
+		int busyWorkers = 0;
+		// Whether or not work was waiting for a worker.
+		bool workPending = false;
+	};
+
+	// What the controller decided after a sample.
+	enum class ConcurrencyAction {
+		HOLD = 0,
+		// Allow one more worker to be active.
+		RAISE,
+		// Stop handing work to one of the active workers once it is idle.
+		LOWER,
+		// Memory is over the ceiling, a busy worker must be stopped and its work handed out again.
+		SHED
+	};
+
+	/**
+	* @brief A change in the number of active workers, with the sample it was based on.
+	*/
+	struct ConcurrencyDecision {
+		ConcurrencyAction action = ConcurrencyAction::HOLD;
+		// Active workers after the decision.
+		int workers = 0;
+		ConcurrencySample sample;
+		double pagesPerSecond = 0.0;
+	};
+
+	/**
+	* @brief Decides how many workers may be active from their measured memory use and
+	* throughput. Workers are added one at a time while the memory left under the ceiling
+	* fits another of the largest workers seen, and while each added worker still raised
+	* the pages per second. Workers are removed one at a time as memory nears the ceiling
+	* or the system runs low, waiting for each removal to take effect before the next, and
+	* a busy worker is shed once either is exceeded, before the kernel's out of memory
+	* killer picks a process itself.
+	*/
+	class ConcurrencyController {
+	private:
+		ConcurrencySettings mSettings;
+		int mWorkers = 1;
+		// Largest resident memory of a single worker, decaying slowly once the largest
+		// documents are done, as the cost of one more worker.
+		uint64_t mWorkerPeakBytes = 0;
+		// Smoothed pages per second measured with each number of active workers.
+		std::map<int, double> mRates;
+		// Samples taken since the number of active workers last changed.
+		int mSamplesAtLevel = 0;
+		std::vector<ConcurrencyDecision> mDecisions;
+
+		// Memory the system should keep available, below which workers are removed.
+		uint64_t GetReserveBytes() const;
+		ConcurrencyAction Decide(const ConcurrencySample& sample, double rate);
+
+	public:
+		/**
+		* Create a controller starting with a single active worker.
+		*
+		* @param settings Memory ceiling and most workers.
+		*/
+		explicit ConcurrencyController(const ConcurrencySettings& settings);
+		/**
+		* Get the number of workers that may be active.
+		*
+		* @returns The number of active workers.
+		*/
+		int GetWorkers() const { return mWorkers; }
+		/**
+		* Update the number of active workers from a new sample.
+		*
+		* @param sample Memory use and throughput over the last interval.
+		*
+		* @returns What the caller should do, SHED meaning one busy worker should be stopped.
+		*/
+		ConcurrencyAction Update(const ConcurrencySample& sample);
+		/**
+		* Convert the decisions that changed the number of active workers to JSON for the report.
+		*
+		* @returns The decisions as a JSON array.
+		*/
+		nlohmann::json DecisionsToJson() const;
+	};
+} // namespace textextract
+#endif
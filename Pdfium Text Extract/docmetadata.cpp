@@ -0,0 +1,45 @@
+#include "docmetadata.h"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <nlohmann/json.hpp>
+
+namespace textextract {
+	bool WriteDocumentMetadata(
+		const std::filesystem::path& writeLocation, const std::string& fileName, const DocumentMetadata& metadata) {
+		nlohmann::json j;
+		j["file"] = fileName;
+		j["page_count"] = metadata.pageCount;
+		j["elapsed_ms"] = metadata.elapsedMs;
+
+		int textpages = 0;
+		std::map<std::string, int> pagetypes;
+		nlohmann::json pages = nlohmann::json::array();
+		for (const auto& page : metadata.pages) {
+			if (page.charCount > 0) textpages++;
+			pagetypes[PageTypeToString(page.pageSize.GetType())]++;
+			// Each page is an array of page, width, height, type, rotation and character
+			// count, to keep the summary of large documents small.
+			pages.push_back({
+				page.pageNumber,
+				page.pageSize.GetPageDimensions().width,
+				page.pageSize.GetPageDimensions().height,
+				PageTypeToString(page.pageSize.GetType()),
+				static_cast<int>(page.rotation) * 90,
+				page.charCount });
+		}
+		j["text_pages"] = textpages;
+		j["page_types"] = pagetypes;
+		j["page_fields"] = { "page", "width", "height", "type", "rotation", "chars" };
+		j["pages"] = pages;
+
+		std::ofstream file(writeLocation);
+		if (!file.is_open()) {
+			std::cerr << "Error opening the metadata file: " << writeLocation.string() << std::endl;
+			return false;
+		}
+		file << j.dump();
+		return true;
+	}
+} // namespace textextract
@@ -0,0 +1,50 @@
+#ifndef DOC_METADATA
+#define DOC_METADATA
+
+#include <filesystem>
+#include <vector>
+
+#include "viewutils.h"
+
+namespace textextract {
+	/**
+	* @brief What is known about a page without rendering it or extracting its text.
+	*/
+	struct PageMetadata {
+		// One based page number.
+		int pageNumber = 0;
+		// Size of the page in points, and the standard page type it matches.
+		PageSize pageSize;
+		// Clockwise rotation of the page.
+		PageRotation rotation = PageRotation::NO_ROTATION;
+		// Number of characters in the page's text layer, 0 for pages without text.
+		int charCount = 0;
+	};
+
+	/**
+	* @brief Summary of a whole document, used to estimate the cost of extracting it.
+	*/
+	struct DocumentMetadata {
+		// Number of pages of the document.
+		int pageCount = 0;
+		// Metadata of each page, in page order.
+		std::vector<PageMetadata> pages;
+		// Time taken to gather the metadata, in milliseconds.
+		double elapsedMs = 0.0;
+	};
+
+	/**
+	* Write the metadata of a document as compact JSON: page count, number of pages with
+	* text, page counts per page type, and the size, type, rotation and character count
+	* of each page.
+	*
+	* @param writeLocation Path of the JSON file to write.
+	* @param fileName Name of the document the metadata belongs to.
+	* @param metadata The document metadata.
+	*
+	* @returns True if the file was written.
+	*/
+	bool WriteDocumentMetadata(
+		const std::filesystem::path& writeLocation, const std::string& fileName, const DocumentMetadata& metadata);
+} // namespace textextract
+#endif
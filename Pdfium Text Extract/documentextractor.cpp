@@ -0,0 +1,51 @@
+#include "documentextractor.h"
+
+#include "pagerange.h"
+#include "pdfrenderer.h"
+
+namespace textextract {
+	DocumentExtractor::DocumentExtractor(const std::string& pdfPath)
+		: mRenderer(std::make_unique<PdfRenderer>(pdfPath)) {}
+
+	DocumentExtractor::~DocumentExtractor() {
+		Close();
+	}
+
+	bool DocumentExtractor::IsLoaded() const {
+		return mRenderer && mRenderer->BufferLoaded();
+	}
+
+	int DocumentExtractor::GetPageCount() const {
+		return IsLoaded() ? mRenderer->GetPageCount() : 0;
+	}
+
+	PageResult DocumentExtractor::ExtractPage(int pageNumber, const StreamOptions& options, PageVisitor& visitor) {
+		if (!IsLoaded() || pageNumber < 1 || pageNumber > GetPageCount()) {
+			PageResult result;
+			result.pageNumber = pageNumber;
+			result.Fail("page_load", IsLoaded() ? "page is out of range" : "document is not loaded");
+			VisitFailedPage(visitor, result);
+			return result;
+		}
+		return mRenderer->StreamPage(pageNumber - 1, options, visitor);
+	}
+
+	bool DocumentExtractor::ExtractPages(const std::string& pageSet, const StreamOptions& options,
+		PageVisitor& visitor, std::vector<PageResult>& results, std::string& error) {
+		if (!IsLoaded()) {
+			error = "document is not loaded";
+			return false;
+		}
+		PageRange pages;
+		if (!pages.ParsePageRange(pageSet, GetPageCount(), error)) return false;
+		results.reserve(results.size() + pages.pages.size());
+		for (int page : pages.pages) {
+			results.push_back(ExtractPage(page, options, visitor));
+		}
+		return true;
+	}
+
+	void DocumentExtractor::Close() {
+		if (mRenderer) mRenderer->CloseDocument();
+	}
+} // namespace textextract
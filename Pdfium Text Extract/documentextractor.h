@@ -0,0 +1,78 @@
+#ifndef DOCUMENT_EXTRACTOR
+#define DOCUMENT_EXTRACTOR
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pageresult.h"
+#include "pagevisitor.h"
+
+namespace textextract {
+	class PdfRenderer;
+
+	/**
+	* @brief Entry point for using the extraction as a library. Opens a document and streams
+	* the contents of its pages to a PageVisitor as they are produced, without going through
+	* the page information or the result files.
+	*
+	* The document is parsed on the first page extracted and stays open until Close or the
+	* extractor is destroyed. pdfium keeps global state, so only one extractor may be used
+	* at a time in a process.
+	*/
+	class DocumentExtractor {
+	private:
+		std::unique_ptr<PdfRenderer> mRenderer;
+
+	public:
+		/**
+		* Load a PDF into memory, ready to extract its pages.
+		*
+		* @param pdfPath Path to the PDF.
+		*/
+		explicit DocumentExtractor(const std::string& pdfPath);
+		~DocumentExtractor();
+		DocumentExtractor(const DocumentExtractor&) = delete;
+		DocumentExtractor& operator=(const DocumentExtractor&) = delete;
+		/**
+		* Determine if the PDF was loaded.
+		*
+		* @returns True if pages can be extracted.
+		*/
+		bool IsLoaded() const;
+		/**
+		* Get the number of pages of the PDF.
+		*
+		* @returns The page count.
+		*/
+		int GetPageCount() const;
+		/**
+		* Stream the contents of a single page to a visitor.
+		*
+		* @param pageNumber One based page number.
+		* @param options Which parts of the page are streamed.
+		* @param visitor Receives the contents of the page.
+		*
+		* @returns Whether the page was processed cleanly, degraded or failed, and why.
+		*/
+		PageResult ExtractPage(int pageNumber, const StreamOptions& options, PageVisitor& visitor);
+		/**
+		* Stream the contents of a set of pages to a visitor, one page after the other.
+		*
+		* @param pageSet Page set expression, as given to --pagerange.
+		* @param options Which parts of each page are streamed.
+		* @param visitor Receives the contents of each page.
+		* @param results Set to the result of each page, in the order they were extracted.
+		* @param error Set to the reason the pages could not be extracted.
+		*
+		* @returns False if the PDF was not loaded or the page set is invalid.
+		*/
+		bool ExtractPages(const std::string& pageSet, const StreamOptions& options, PageVisitor& visitor,
+			std::vector<PageResult>& results, std::string& error);
+		/**
+		* Close the document, running its close actions.
+		*/
+		void Close();
+	};
+} // namespace textextract
+#endif
@@ -0,0 +1,385 @@
+#include "forkedpages.h"
+
+#include "memorystats.h"
+#include "stagetimer.h"
+#include "workerpipe.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifndef _WIN32
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#endif
+
+namespace textextract {
+	bool ParseForkMode(const std::string& name, ForkMode& mode) {
+		if (name == "shared") mode = ForkMode::SHARED;
+		else if (name == "independent") mode = ForkMode::INDEPENDENT;
+		else return false;
+		return true;
+	}
+
+	nlohmann::json ForkedPagesReportToJson(const ForkedPagesReport& report) {
+		nlohmann::json j;
+		j["mode"] = report.mode == ForkMode::SHARED ? "shared" : "independent";
+		j["workers"] = report.workers;
+		j["load_ms"] = report.loadMs;
+		j["startup_ms"] = report.startupMs;
+		j["elapsed_ms"] = report.elapsedMs;
+		j["parent_rss_bytes"] = report.parentRssBytes;
+		j["worker_rss_bytes"] = report.workerRssBytes;
+		j["total_pss_bytes"] = report.totalPssBytes;
+		j["restarts"] = report.restarts;
+		j["ring_pages"] = report.ringPages;
+		j["worker_written_pages"] = report.workerWrittenPages;
+		return j;
+	}
+
+#ifndef _WIN32
+	namespace {
+		typedef std::chrono::steady_clock Clock;
+
+		// Time between the heartbeats of a page worker whose page is making progress.
+		const int PAGE_HEARTBEAT_MS = 250;
+		// Time the parent waits for messages before checking the page timeout.
+		const int POLL_INTERVAL_MS = 100;
+
+		// Body of a page worker: parse the document if needed, then process each page
+		// read from pageFd until the parent closes the pipe. Messages sent back are
+		// R <ok> once ready, S <page> as a page starts, O <slot> <result> for a page
+		// published to the ring or E <result> for a page written by the worker, H while
+		// the page makes progress, and M <rss> <pss> before exiting.
+		void PageWorkerMain(const std::function<bool()>& prepare,
+			const std::function<PageResult(int pageNumber)>& runner,
+			const std::function<void(PageResult& result)>& consume, ResultRing* ring, int pageFd, int resultFd) {
+			EnableProgress();
+			std::atomic<bool> running{ true };
+			std::thread heartbeat([&]() {
+				uint64_t lastprogress = GetProgress();
+				while (running.load()) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(PAGE_HEARTBEAT_MS));
+					uint64_t progress = GetProgress();
+					if (progress != lastprogress) WritePipeLine(resultFd, "H");
+					lastprogress = progress;
+				}
+			});
+			WritePipeLine(resultFd, std::string("R ") + (prepare() ? "1" : "0"));
+			PipeProgress progress(resultFd);
+			PipeLineReader pagereader(pageFd);
+			std::string message;
+			while (pagereader.ReadLine(message)) {
+				int pagenumber = 0;
+				if (sscanf(message.c_str(), "P %d", &pagenumber) != 1) continue;
+				progress.PageStarted(pagenumber);
+				PageResult result = runner(pagenumber);
+				int slot = ring && result.status != PageStatus::FAILED ? ring->Publish(pagenumber) : -1;
+				if (slot >= 0) {
+					WritePipeLine(resultFd, "O " + std::to_string(slot) + " " + EncodePageResult(result));
+				}
+				else {
+					consume(result);
+					progress.PageFinished(result);
+				}
+			}
+			running.store(false);
+			heartbeat.join();
+			WritePipeLine(resultFd, "M " + std::to_string(ReadProcessMemory().rssBytes) + " " +
+				std::to_string(ReadProportionalSetSize()));
+		}
+
+		struct PageWorker {
+			pid_t pid = -1;
+			int pageFd = -1;
+			int resultFd = -1;
+			std::unique_ptr<PipeLineReader> reader;
+			bool ready = false;
+			// Page being processed, 0 when idle.
+			int page = 0;
+			Clock::time_point pageStart;
+			// Whether or not the worker was killed for exceeding the page timeout.
+			bool timedOut = false;
+		};
+
+		class PageWorkers {
+		private:
+			const std::function<bool()>& mPrepare;
+			const std::function<PageResult(int pageNumber)>& mRunner;
+			const std::function<void(PageResult& result)>& mConsume;
+			ResultRing* mRing;
+			PageProgress* mProgress;
+			int mPageTimeoutMs;
+			std::vector<PageResult>& mResults;
+			ForkedPagesReport& mReport;
+			std::vector<PageWorker> mWorkers;
+			std::deque<int> mPending;
+			Clock::time_point mStart;
+
+			double SinceStart() const {
+				return std::chrono::duration<double, std::milli>(Clock::now() - mStart).count();
+			}
+
+			void Finish(const PageResult& result) {
+				mResults.push_back(result);
+				if (mProgress) mProgress->PageFinished(result);
+			}
+
+			bool Start(PageWorker& worker) {
+				int pagepipe[2];
+				int resultpipe[2];
+				if (pipe(pagepipe) != 0) return false;
+				if (pipe(resultpipe) != 0) {
+					close(pagepipe[0]);
+					close(pagepipe[1]);
+					return false;
+				}
+				fflush(stdout);
+				fflush(stderr);
+				pid_t pid = fork();
+				if (pid < 0) {
+					close(pagepipe[0]);
+					close(pagepipe[1]);
+					close(resultpipe[0]);
+					close(resultpipe[1]);
+					return false;
+				}
+				if (pid == 0) {
+					for (const auto& other : mWorkers) {
+						if (other.pageFd >= 0) close(other.pageFd);
+						if (other.resultFd >= 0) close(other.resultFd);
+					}
+					close(pagepipe[1]);
+					close(resultpipe[0]);
+					signal(SIGPIPE, SIG_DFL);
+#ifdef __linux__
+					// A page worker stuck inside pdfium would otherwise outlive its parent.
+					prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+					PageWorkerMain(mPrepare, mRunner, mConsume, mRing, pagepipe[0], resultpipe[1]);
+					fflush(stdout);
+					fflush(stderr);
+					_exit(0);
+				}
+				close(pagepipe[0]);
+				close(resultpipe[1]);
+				worker = PageWorker();
+				worker.pid = pid;
+				worker.pageFd = pagepipe[1];
+				worker.resultFd = resultpipe[0];
+				worker.reader = std::make_unique<PipeLineReader>(worker.resultFd);
+				return true;
+			}
+
+			void HandleMessage(PageWorker& worker, const std::string& message) {
+				// The workers' progress is this process's progress, for the heartbeat of a
+				// supervised worker running them.
+				NoteProgress();
+				if (message.rfind("S ", 0) == 0) {
+					if (mProgress) mProgress->PageStarted(std::stoi(message.substr(2)));
+				}
+				else if (message.rfind("R ", 0) == 0) {
+					worker.ready = true;
+					if (message == "R 0") std::cerr << "A page worker could not parse the document." << std::endl;
+					bool allready = std::all_of(mWorkers.begin(), mWorkers.end(),
+						[](const PageWorker& w) { return w.pid <= 0 || w.ready; });
+					if (allready && mReport.startupMs == 0.0) mReport.startupMs = SinceStart();
+				}
+				else if (message.rfind("E ", 0) == 0) {
+					PageResult result;
+					if (DecodePageResult(message.substr(2), result)) Finish(result);
+					mReport.workerWrittenPages++;
+					worker.page = 0;
+				}
+				else if (message.rfind("O ", 0) == 0) {
+					// The page is written straight from the slot, which is then free for the next page.
+					size_t fields = message.find(' ', 2);
+					int slot = std::stoi(message.substr(2, fields - 2));
+					PageResult result;
+					if (fields != std::string::npos && DecodePageResult(message.substr(fields + 1), result)) {
+						if (mRing->Load(slot) == result.pageNumber) {
+							mConsume(result);
+						}
+						else {
+							result.Fail("result_ring", "slot did not hold the page");
+						}
+						Finish(result);
+						mReport.ringPages++;
+					}
+					mRing->Release(slot);
+					worker.page = 0;
+				}
+				else if (message.rfind("M ", 0) == 0) {
+					uint64_t rss = 0;
+					uint64_t pss = 0;
+					std::istringstream(message.substr(2)) >> rss >> pss;
+					mReport.workerRssBytes += rss;
+					mReport.totalPssBytes += pss;
+				}
+			}
+
+			// Reap a worker whose pipe closed, failing the page it was on and forking a replacement.
+			void Replace(PageWorker& worker) {
+				int status = 0;
+				waitpid(worker.pid, &status, 0);
+				close(worker.pageFd);
+				close(worker.resultFd);
+				if (mRing) mRing->ReclaimFrom(worker.pid);
+				worker.pid = -1;
+				if (worker.page > 0) {
+					PageResult result;
+					result.pageNumber = worker.page;
+					if (worker.timedOut) {
+						result.Fail("page_timeout", "page exceeded the " + std::to_string(mPageTimeoutMs) + "ms page timeout");
+						std::cerr << "Page worker killed after the page timeout on page " << worker.page << "." << std::endl;
+					}
+					else {
+						result.Fail("worker", WIFSIGNALED(status) ?
+							"worker was killed by signal " + std::to_string(WTERMSIG(status)) :
+							"worker exited with code " + std::to_string(WEXITSTATUS(status)));
+						std::cerr << "Page worker died on page " << worker.page << "." << std::endl;
+					}
+					Finish(result);
+				}
+				mReport.restarts++;
+				if (!Start(worker)) std::cerr << "Failed to start a replacement page worker." << std::endl;
+			}
+
+			// Wait for messages from the workers, replacing any that die.
+			bool Poll() {
+				std::vector<pollfd> fds;
+				std::vector<PageWorker*> polled;
+				for (auto& worker : mWorkers) {
+					if (worker.pid <= 0) continue;
+					fds.push_back({ worker.resultFd, POLLIN, 0 });
+					polled.push_back(&worker);
+				}
+				if (fds.empty()) return false;
+				int ready = poll(fds.data(), fds.size(), POLL_INTERVAL_MS);
+				if (ready < 0 && errno != EINTR) {
+					std::cerr << "Error waiting on page workers: " << strerror(errno) << std::endl;
+					return false;
+				}
+				for (size_t i = 0; i < fds.size() && ready > 0; i++) {
+					if (fds[i].revents == 0) continue;
+					PageWorker& worker = *polled[i];
+					std::vector<std::string> messages;
+					bool open = worker.reader->Read(messages);
+					for (const auto& message : messages) HandleMessage(worker, message);
+					if (!open) Replace(worker);
+				}
+				return true;
+			}
+
+			// Kill the workers that have spent longer than the page timeout on their page.
+			// They are replaced once their pipe is seen to close.
+			void CheckTimeouts() {
+				if (mPageTimeoutMs <= 0) return;
+				auto now = Clock::now();
+				for (auto& worker : mWorkers) {
+					if (worker.pid <= 0 || worker.page == 0 || worker.timedOut) continue;
+					if (std::chrono::duration_cast<std::chrono::milliseconds>(now - worker.pageStart).count() > mPageTimeoutMs) {
+						kill(worker.pid, SIGKILL);
+						worker.timedOut = true;
+					}
+				}
+			}
+
+		public:
+			PageWorkers(const std::function<bool()>& prepare, const std::function<PageResult(int pageNumber)>& runner,
+				const std::function<void(PageResult& result)>& consume, ResultRing* ring, PageProgress* progress,
+				int pageTimeoutMs, std::vector<PageResult>& results, ForkedPagesReport& report)
+				: mPrepare(prepare), mRunner(runner), mConsume(consume), mRing(ring), mProgress(progress),
+				mPageTimeoutMs(pageTimeoutMs), mResults(results), mReport(report) {}
+
+			void Run(const std::vector<int>& pages, int workers, Clock::time_point start) {
+				mStart = start;
+				mPending.assign(pages.begin(), pages.end());
+				mWorkers.resize(std::max(workers, 1));
+				for (auto& worker : mWorkers) {
+					if (!Start(worker)) std::cerr << "Failed to start a page worker." << std::endl;
+				}
+
+				while (true) {
+					bool anybusy = false;
+					for (auto& worker : mWorkers) {
+						if (worker.pid > 0 && worker.page == 0 && !mPending.empty()) {
+							worker.page = mPending.front();
+							worker.pageStart = Clock::now();
+							mPending.pop_front();
+							WritePipeLine(worker.pageFd, "P " + std::to_string(worker.page));
+						}
+						anybusy = anybusy || (worker.pid > 0 && worker.page > 0);
+					}
+					if (!anybusy && mPending.empty()) break;
+					if (!Poll()) break;
+					CheckTimeouts();
+				}
+				mReport.elapsedMs = SinceStart();
+
+				// The parent is measured while the workers still share its pages.
+				mReport.parentRssBytes = ReadProcessMemory().rssBytes;
+				mReport.totalPssBytes += ReadProportionalSetSize();
+				for (auto& worker : mWorkers) {
+					if (worker.pid <= 0) continue;
+					// Closing the page pipe tells the worker to report its memory and exit.
+					close(worker.pageFd);
+					std::vector<std::string> messages;
+					while (worker.reader->Read(messages)) {}
+					for (const auto& message : messages) HandleMessage(worker, message);
+					int status = 0;
+					waitpid(worker.pid, &status, 0);
+					close(worker.resultFd);
+				}
+				for (int page : mPending) {
+					PageResult result;
+					result.pageNumber = page;
+					result.Fail("worker", "no page worker could be started");
+					Finish(result);
+				}
+			}
+		};
+	} // namespace
+
+	bool RunForkedPages(const std::vector<int>& pages, const ForkedPagesSettings& settings,
+		const std::function<bool()>& prepare, const std::function<PageResult(int pageNumber)>& runner,
+		const std::function<void(PageResult& result)>& consume, ResultRing* ring, PageProgress* progress,
+		std::vector<PageResult>& results, ForkedPagesReport& report) {
+		signal(SIGPIPE, SIG_IGN);
+		results.clear();
+		report = ForkedPagesReport();
+		report.mode = settings.mode;
+		report.workers = settings.workers;
+		auto start = Clock::now();
+		if (settings.mode == ForkMode::SHARED) {
+			if (!prepare()) return false;
+			report.loadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+		if (ring && !ring->IsCreated()) ring = nullptr;
+		PageWorkers pageworkers(prepare, runner, consume, ring, progress, settings.pageTimeoutMs, results, report);
+		pageworkers.Run(pages, settings.workers, start);
+		std::sort(results.begin(), results.end(),
+			[](const PageResult& a, const PageResult& b) { return a.pageNumber < b.pageNumber; });
+		return true;
+	}
+#else
+	bool RunForkedPages(const std::vector<int>& pages, const ForkedPagesSettings& settings,
+		const std::function<bool()>& prepare, const std::function<PageResult(int pageNumber)>& runner,
+		const std::function<void(PageResult& result)>& consume, ResultRing* ring, PageProgress* progress,
+		std::vector<PageResult>& results, ForkedPagesReport& report) {
+		std::cerr << "Page workers are only supported on POSIX systems, processing in a single process." << std::endl;
+		return false;
+	}
+#endif
+} // namespace textextract
@@ -0,0 +1,115 @@
+#ifndef FORKED_PAGES
+#define FORKED_PAGES
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "pageresult.h"
+#include "resultring.h"
+
+namespace textextract {
+	// Where the page workers of a single document get their parsed copy of the document from.
+	enum class ForkMode {
+		// The document is parsed once before forking, and the workers share the parsed
+		// objects copy-on-write.
+		SHARED = 0,
+		// Each worker parses the document itself, as independently started workers would.
+		INDEPENDENT = 1
+	};
+
+	/**
+	* Parse a fork mode from its name.
+	*
+	* @param name Either shared or independent.
+	* @param mode Set to the fork mode the name refers to.
+	*
+	* @returns True if the name was recognised.
+	*/
+	bool ParseForkMode(const std::string& name, ForkMode& mode);
+
+	/**
+	* @brief Number of page workers, how they get the document, and how long a page may take.
+	*/
+	struct ForkedPagesSettings {
+		int workers = 1;
+		ForkMode mode = ForkMode::SHARED;
+		// Time a single page may take before its worker is killed and the page failed,
+		// 0 for no limit.
+		int pageTimeoutMs = 0;
+	};
+
+	/**
+	* @brief Startup time and memory use of a run of page workers, for comparing the fork modes.
+	*/
+	struct ForkedPagesReport {
+		ForkMode mode = ForkMode::SHARED;
+		int workers = 0;
+		// Time taken to parse the document before forking, in milliseconds.
+		double loadMs = 0.0;
+		// Time from the start of the run until every worker had the document parsed and
+		// was ready for pages, in milliseconds.
+		double startupMs = 0.0;
+		// Time from the start of the run until the last page finished, in milliseconds.
+		double elapsedMs = 0.0;
+		// Resident set size of the parent and the sum over the workers, in bytes. Pages
+		// shared copy-on-write are counted once per process.
+		uint64_t parentRssBytes = 0;
+		uint64_t workerRssBytes = 0;
+		// Proportional set size of the parent and all workers together, in bytes, which
+		// counts shared pages once overall.
+		uint64_t totalPssBytes = 0;
+		// Workers forked again after one died.
+		int restarts = 0;
+		// Pages written by the parent from the result ring, and pages the workers wrote
+		// themselves because they did not fit in a slot.
+		int ringPages = 0;
+		int workerWrittenPages = 0;
+	};
+
+	/**
+	* Convert the page worker report to JSON for the page report.
+	*
+	* @param report The page worker report.
+	*
+	* @returns The report as JSON.
+	*/
+	nlohmann::json ForkedPagesReportToJson(const ForkedPagesReport& report);
+
+	/**
+	* Process the pages of a single document in forked worker processes. In shared mode
+	* prepare is called once before forking, so that every worker inherits the parsed
+	* document copy-on-write, in independent mode each worker calls prepare itself. Pages
+	* are handed to whichever worker is idle, and their status is sent back over a pipe.
+	* When a result ring is given, workers move each page's information into it and the
+	* parent writes the output from the ring, otherwise workers write their own output.
+	* The page a worker dies on, or spends longer than the page timeout on, is reported as
+	* failed, and a new worker is forked in its place. The workers send heartbeats while
+	* their pages make progress, which count as progress of the calling process, and the
+	* start and result of every page are passed on to progress. Only supported on POSIX
+	* systems.
+	*
+	* @param pages Page numbers of the pages to process.
+	* @param settings Number of worker processes, fork mode and page timeout.
+	* @param prepare Parses the document, returning false if it could not be.
+	* @param runner Processes a single page into the current page information, called in
+	* the worker processes.
+	* @param consume Writes the output of the current page information and clears it,
+	* updating the page's result if that fails.
+	* @param ring Ring the workers publish pages to, created before the call, or null.
+	* @param progress Receives the start and result of each page, or null.
+	* @param results Set to the results of the pages, in page order.
+	* @param report Set to the startup time and memory use of the run.
+	*
+	* @returns False if worker processes are not supported, or the document could not be
+	* parsed before forking, in which case nothing was processed.
+	*/
+	bool RunForkedPages(const std::vector<int>& pages, const ForkedPagesSettings& settings,
+		const std::function<bool()>& prepare, const std::function<PageResult(int pageNumber)>& runner,
+		const std::function<void(PageResult& result)>& consume, ResultRing* ring, PageProgress* progress,
+		std::vector<PageResult>& results, ForkedPagesReport& report);
+} // namespace textextract
+#endif
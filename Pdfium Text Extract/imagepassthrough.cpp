@@ -0,0 +1,190 @@
+#include "imagepassthrough.h"
+
+#include "pdfium/cpp/fpdf_scopers.h"
+#include "pdfium/fpdf_annot.h"
+#include "pdfium/fpdf_edit.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace textextract {
+	namespace {
+		// Fraction of the page the image has to cover to stand in for a render of the page.
+		const double FULL_PAGE_IMAGE_COVERAGE = 0.5;
+
+		// Largest mean difference in gray levels between the image as pdfium draws it and
+		// the written bytes decoded on their own, above which the image is rendered instead.
+		const double MAX_MEAN_DIFFERENCE = 16.0;
+
+		// Filters whose encoded bytes are a complete image file, along with the file
+		// extension they are written with. CCITT streams are left out, as they cannot be
+		// decoded without the /K, /Columns and /BlackIs1 parameters of the PDF.
+		struct PassthroughFilter {
+			const char* filter;
+			const char* extension;
+		};
+		const PassthroughFilter PASSTHROUGH_FILTERS[] = {
+			{ "DCTDecode", ".jpg" },
+			{ "JPXDecode", ".jp2" } };
+
+		std::string GetImageFilter(FPDF_PAGEOBJECT image, int index) {
+			unsigned long length = FPDFImageObj_GetImageFilter(image, index, nullptr, 0);
+			if (length == 0) return "";
+			std::vector<char> buffer(length);
+			FPDFImageObj_GetImageFilter(image, index, buffer.data(), length);
+			return std::string(buffer.data());
+		}
+
+		// Colorspaces that an image decoder handles without the PDF's colorspace resources.
+		// Only JPEG 2000 images may leave out the colorspace, carrying it in the codestream,
+		// other images without one are image masks.
+		bool IsPassthroughColorspace(int colorspace, const std::string& filter) {
+			switch (colorspace) {
+			case FPDF_COLORSPACE_UNKNOWN:
+				return filter == "JPXDecode";
+			case FPDF_COLORSPACE_DEVICEGRAY:
+			case FPDF_COLORSPACE_DEVICERGB:
+			case FPDF_COLORSPACE_DEVICECMYK:
+			case FPDF_COLORSPACE_CALGRAY:
+			case FPDF_COLORSPACE_CALRGB:
+			case FPDF_COLORSPACE_ICCBASED:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// The only object on the page, if it is an image covering most of the page. Pages
+		// with paths, text, shadings, form objects or annotations drawn over the image are
+		// rendered, as the image alone would lose them. So are pages with a /Rotate, which
+		// the written image would not carry.
+		FPDF_PAGEOBJECT FindPageImage(FPDF_PAGE page) {
+			if (FPDFPage_GetRotation(page) != 0) return nullptr;
+			if (FPDFPage_GetAnnotCount(page) > 0) return nullptr;
+
+			FPDF_PAGEOBJECT pageimage = nullptr;
+			int count = FPDFPage_CountObjects(page);
+			for (int i = 0; i < count; i++) {
+				FPDF_PAGEOBJECT object = FPDFPage_GetObject(page, i);
+				// Images inside form objects are placed by a second matrix, so they are rendered too.
+				if (FPDFPageObj_GetType(object) != FPDF_PAGEOBJ_IMAGE) return nullptr;
+				if (pageimage) return nullptr;
+				pageimage = object;
+			}
+			if (!pageimage) return nullptr;
+
+			float left = 0, bottom = 0, right = 0, top = 0;
+			if (!FPDFPageObj_GetBounds(pageimage, &left, &bottom, &right, &top)) return nullptr;
+			double imagearea = static_cast<double>(right - left) * (top - bottom);
+			double pagearea = static_cast<double>(FPDF_GetPageWidthF(page)) * FPDF_GetPageHeightF(page);
+			return imagearea >= FULL_PAGE_IMAGE_COVERAGE * pagearea ? pageimage : nullptr;
+		}
+
+		// Turn the decoded image the way its matrix places it on the page. Only matrices
+		// that scale, flip or turn by a multiple of 90 degrees are handled.
+		bool OrientAsPlaced(const FS_MATRIX& matrix, cv::Mat& image) {
+			// Image rows run from the top of the unit square down, the bitmap's rows from the top of the page down.
+			if (matrix.b == 0 && matrix.c == 0) {
+				if (matrix.a < 0 && matrix.d < 0) cv::flip(image, image, -1);
+				else if (matrix.a < 0) cv::flip(image, image, 1);
+				else if (matrix.d < 0) cv::flip(image, image, 0);
+				return true;
+			}
+			if (matrix.a == 0 && matrix.d == 0) {
+				// Image columns run along the page's y axis and image rows along its x axis.
+				cv::transpose(image, image);
+				if (matrix.b > 0 && matrix.c > 0) cv::flip(image, image, -1);
+				else if (matrix.b > 0) cv::flip(image, image, 0);
+				else if (matrix.c > 0) cv::flip(image, image, 1);
+				return true;
+			}
+			return false;
+		}
+
+		// Check that the written bytes decode to what pdfium draws for the image. pdfium
+		// applies the image's /Decode array, /SMask and /Mask, which an OCR engine reading
+		// the bytes never sees, so an image using any of them would come out inverted or
+		// unmasked. The image is compared as placed on the page, at one pixel per point.
+		bool MatchesRenderedImage(FPDF_DOCUMENT doc, FPDF_PAGE page, FPDF_PAGEOBJECT pageimage,
+			const FS_MATRIX& matrix, const std::vector<char>& data) {
+			ScopedFPDFBitmap rendered(FPDFImageObj_GetRenderedBitmap(doc, page, pageimage));
+			if (!rendered) return false;
+			int width = FPDFBitmap_GetWidth(rendered.get());
+			int height = FPDFBitmap_GetHeight(rendered.get());
+			if (width <= 0 || height <= 0 || FPDFBitmap_GetFormat(rendered.get()) != FPDFBitmap_BGRA) return false;
+			cv::Mat bgra(height, width, CV_8UC4, FPDFBitmap_GetBuffer(rendered.get()), FPDFBitmap_GetStride(rendered.get()));
+			// Masked out pixels are transparent, and are compared as the white page under them.
+			cv::Mat drawn(height, width, CV_8UC1);
+			for (int y = 0; y < height; y++) {
+				const cv::Vec4b* source = bgra.ptr<cv::Vec4b>(y);
+				unsigned char* target = drawn.ptr<unsigned char>(y);
+				for (int x = 0; x < width; x++) {
+					double alpha = source[x][3] / 255.0;
+					double gray = 0.114 * source[x][0] + 0.587 * source[x][1] + 0.299 * source[x][2];
+					target[x] = cv::saturate_cast<unsigned char>(gray * alpha + 255.0 * (1.0 - alpha));
+				}
+			}
+
+			cv::Mat decoded = cv::imdecode(cv::Mat(1, static_cast<int>(data.size()), CV_8UC1,
+				const_cast<char*>(data.data())), cv::IMREAD_GRAYSCALE);
+			if (decoded.empty() || !OrientAsPlaced(matrix, decoded)) return false;
+			cv::resize(decoded, decoded, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+			cv::Mat difference;
+			cv::absdiff(decoded, drawn, difference);
+			return cv::mean(difference)[0] <= MAX_MEAN_DIFFERENCE;
+		}
+	} // namespace
+
+	bool WritePassthroughImage(FPDF_DOCUMENT doc, FPDF_PAGE page, const std::filesystem::path& basePath,
+		PassthroughImage& image) {
+		FPDF_PAGEOBJECT pageimage = FindPageImage(page);
+		if (!pageimage) return false;
+		// Soft masks and constant alpha from the graphics state change how the image looks.
+		if (FPDFPageObj_HasTransparency(pageimage)) return false;
+		if (FPDFImageObj_GetImageFilterCount(pageimage) != 1) return false;
+		std::string filter = GetImageFilter(pageimage, 0);
+		const char* extension = nullptr;
+		for (const auto& passthrough : PASSTHROUGH_FILTERS) {
+			if (filter == passthrough.filter) extension = passthrough.extension;
+		}
+		if (!extension) return false;
+
+		FPDF_IMAGEOBJ_METADATA metadata;
+		if (!FPDFImageObj_GetImageMetadata(pageimage, page, &metadata)) return false;
+		if (!IsPassthroughColorspace(metadata.colorspace, filter)) return false;
+		FS_MATRIX matrix;
+		if (!FPDFPageObj_GetMatrix(pageimage, &matrix)) return false;
+
+		unsigned long length = FPDFImageObj_GetImageDataRaw(pageimage, nullptr, 0);
+		if (length == 0) return false;
+		std::vector<char> data(length);
+		FPDFImageObj_GetImageDataRaw(pageimage, data.data(), length);
+		if (!MatchesRenderedImage(doc, page, pageimage, matrix, data)) return false;
+
+		std::filesystem::path imagepath = basePath;
+		imagepath += extension;
+		std::ofstream file(imagepath, std::ios::binary);
+		if (!file.is_open()) {
+			std::cerr << "Error opening the image file: " << imagepath.string() << std::endl;
+			return false;
+		}
+		file.write(data.data(), data.size());
+		if (!file.good()) return false;
+
+		image.path = imagepath;
+		image.filter = filter;
+		image.width = metadata.width;
+		image.height = metadata.height;
+		image.bitsPerPixel = metadata.bits_per_pixel;
+		image.colorspace = metadata.colorspace;
+		image.dpi = metadata.horizontal_dpi;
+		image.matrix = matrix;
+		return true;
+	}
+} // namespace textextract
@@ -0,0 +1,51 @@
+#ifndef IMAGE_PASSTHROUGH
+#define IMAGE_PASSTHROUGH
+
+#include <filesystem>
+#include <string>
+
+#include "pdfium/fpdfview.h"
+
+namespace textextract {
+	/**
+	* @brief An embedded page image written out with its original encoding, in place of
+	* a render of the page.
+	*/
+	struct PassthroughImage {
+		// Path the encoded image was written to.
+		std::filesystem::path path;
+		// The PDF filter the image is encoded with, such as DCTDecode.
+		std::string filter;
+		// Size of the image in pixels.
+		int width = 0;
+		int height = 0;
+		// Number of bits for each pixel, over all channels.
+		int bitsPerPixel = 0;
+		// The image's colorspace, one of FPDF_COLORSPACE_* in fpdf_edit.h.
+		int colorspace = 0;
+		// Horizontal resolution of the image where it is placed on the page.
+		float dpi = 0.0f;
+		// Matrix placing the unit square of the image on the page, in points.
+		FS_MATRIX matrix = { 1, 0, 0, 1, 0, 0 };
+	};
+
+	/**
+	* Find the image covering a page and write its encoded bytes unchanged. Only single
+	* images encoded with DCTDecode (.jpg) or JPXDecode (.jp2) are written. Any other
+	* encoding, a chain of filters, a colorspace that pdfium would have to convert, an
+	* image mask, more than one image, any other object or annotation on the page, or a
+	* page /Rotate leaves the page to be rendered instead. So do images whose /Decode array, soft mask or mask change how they look,
+	* which is found by comparing the bytes decoded on their own with pdfium's drawing of
+	* the image at one pixel per point.
+	*
+	* @param doc The document the page belongs to.
+	* @param page The loaded page.
+	* @param basePath Path to write the image to, without an extension.
+	* @param image Set to the details of the written image.
+	*
+	* @returns True if the image was written.
+	*/
+	bool WritePassthroughImage(FPDF_DOCUMENT doc, FPDF_PAGE page, const std::filesystem::path& basePath,
+		PassthroughImage& image);
+} // namespace textextract
+#endif
@@ -0,0 +1,196 @@
+#include "memorystats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#define MALLOC_SIZE _msize
+#else
+#include <fstream>
+#include <malloc.h>
+#include <string>
+#define MALLOC_SIZE malloc_usable_size
+#endif
+
+namespace textextract {
+	namespace {
+		std::atomic<bool> mTracking{ false };
+		std::atomic<uint64_t> mAllocatedBytes{ 0 };
+		std::atomic<uint64_t> mFreedBytes{ 0 };
+		std::atomic<size_t> mBitmapBytes{ 0 };
+	} // namespace
+
+	void EnableMemoryTracking(bool enabled) {
+		mTracking.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool MemoryTrackingEnabled() {
+		return mTracking.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetAllocatedBytes() {
+		return mAllocatedBytes.load(std::memory_order_relaxed);
+	}
+
+	int64_t GetLiveBytes() {
+		return static_cast<int64_t>(mAllocatedBytes.load(std::memory_order_relaxed)) -
+			static_cast<int64_t>(mFreedBytes.load(std::memory_order_relaxed));
+	}
+
+	void RecordBitmapBytes(size_t bytes) {
+		size_t current = mBitmapBytes.load(std::memory_order_relaxed);
+		while (bytes > current &&
+			!mBitmapBytes.compare_exchange_weak(current, bytes, std::memory_order_relaxed)) {
+		}
+	}
+
+	size_t GetBitmapBytes() {
+		return mBitmapBytes.load(std::memory_order_relaxed);
+	}
+
+	void ResetBitmapBytes() {
+		mBitmapBytes.store(0, std::memory_order_relaxed);
+	}
+
+	ProcessMemory ReadProcessMemory() {
+		ProcessMemory memory;
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+			memory.rssBytes = counters.WorkingSetSize;
+			memory.peakRssBytes = counters.PeakWorkingSetSize;
+		}
+#else
+		// Values in /proc/self/status are given in kB.
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.rfind("VmRSS:", 0) == 0) {
+				memory.rssBytes = std::stoull(line.substr(6)) * 1024;
+			}
+			else if (line.rfind("VmHWM:", 0) == 0) {
+				memory.peakRssBytes = std::stoull(line.substr(6)) * 1024;
+			}
+		}
+#endif
+		return memory;
+	}
+
+	uint64_t ReadProportionalSetSize() {
+#ifdef __linux__
+		// Values in /proc/self/smaps_rollup are given in kB.
+		std::ifstream rollup("/proc/self/smaps_rollup");
+		std::string line;
+		while (std::getline(rollup, line)) {
+			if (line.rfind("Pss:", 0) == 0) return std::stoull(line.substr(4)) * 1024;
+		}
+#endif
+		return 0;
+	}
+
+	uint64_t ReadResidentSetSize(int pid) {
+#ifdef __linux__
+		// Values in /proc/<pid>/status are given in kB.
+		std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.rfind("VmRSS:", 0) == 0) return std::stoull(line.substr(6)) * 1024;
+		}
+#endif
+		return 0;
+	}
+
+#ifdef __linux__
+	namespace {
+		// Read a single number from a cgroup file, false if missing or set to max.
+		bool ReadCgroupValue(const char* path, uint64_t& value) {
+			std::ifstream file(path);
+			std::string text;
+			if (!(file >> text) || text == "max") return false;
+			value = std::stoull(text);
+			return true;
+		}
+	} // namespace
+#endif
+
+	uint64_t ReadAvailableMemory() {
+		uint64_t available = 0;
+#ifdef _WIN32
+		MEMORYSTATUSEX status;
+		status.dwLength = sizeof(status);
+		if (GlobalMemoryStatusEx(&status)) available = status.ullAvailPhys;
+#elif defined(__linux__)
+		// Values in /proc/meminfo are given in kB.
+		std::ifstream meminfo("/proc/meminfo");
+		std::string line;
+		while (std::getline(meminfo, line)) {
+			if (line.rfind("MemAvailable:", 0) == 0) {
+				available = std::stoull(line.substr(13)) * 1024;
+				break;
+			}
+		}
+		// Inside a container the cgroup limit is hit long before the host runs out.
+		uint64_t limit = 0;
+		uint64_t usage = 0;
+		if ((ReadCgroupValue("/sys/fs/cgroup/memory.max", limit) &&
+			ReadCgroupValue("/sys/fs/cgroup/memory.current", usage)) ||
+			(ReadCgroupValue("/sys/fs/cgroup/memory/memory.limit_in_bytes", limit) &&
+			ReadCgroupValue("/sys/fs/cgroup/memory/memory.usage_in_bytes", usage))) {
+			// Unlimited cgroup v1 groups report a huge limit, which never wins over MemAvailable.
+			uint64_t cgroupavailable = limit > usage ? limit - usage : 0;
+			if (available == 0 || cgroupavailable < available) available = cgroupavailable;
+		}
+#endif
+		return available;
+	}
+
+	bool AllocationCountingAvailable() {
+#ifdef TEXTEXTRACT_COUNT_ALLOCATIONS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+#ifdef TEXTEXTRACT_COUNT_ALLOCATIONS
+	// Called from the replacement allocation functions below.
+	void CountAllocation(void* ptr) {
+		if (ptr && mTracking.load(std::memory_order_relaxed)) {
+			mAllocatedBytes.fetch_add(MALLOC_SIZE(ptr), std::memory_order_relaxed);
+		}
+	}
+
+	void CountRelease(void* ptr) {
+		if (ptr && mTracking.load(std::memory_order_relaxed)) {
+			mFreedBytes.fetch_add(MALLOC_SIZE(ptr), std::memory_order_relaxed);
+		}
+	}
+#endif
+} // namespace textextract
+
+#ifdef TEXTEXTRACT_COUNT_ALLOCATIONS
+// Replacement global allocation functions. Sizes are taken from the allocator so that
+// no header needs to be stored with each allocation. The array and nothrow forms call
+// these by default.
+void* operator new(std::size_t size) {
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr) throw std::bad_alloc();
+	textextract::CountAllocation(ptr);
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+	textextract::CountRelease(ptr);
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	textextract::CountRelease(ptr);
+	std::free(ptr);
+}
+#endif
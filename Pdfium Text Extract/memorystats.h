@@ -0,0 +1,103 @@
+#ifndef MEMORY_STATS
+#define MEMORY_STATS
+
+#include <cstddef>
+#include <cstdint>
+
+namespace textextract {
+	/**
+	* @brief Resident memory of the process as reported by the operating system.
+	*/
+	struct ProcessMemory {
+		// Current resident set size in bytes.
+		uint64_t rssBytes = 0;
+		// Highest resident set size reached so far, in bytes.
+		uint64_t peakRssBytes = 0;
+	};
+
+	/**
+	* Turn memory tracking on or off. While on, the memory stats are recorded, and in builds
+	* that count allocations every allocation made through operator new and released through
+	* operator delete is counted. Allocations made inside pdfium, or by OpenCV for image
+	* data, are not seen and only show up in the resident set size.
+	*
+	* @param enabled True to track memory.
+	*/
+	void EnableMemoryTracking(bool enabled);
+	/**
+	* Determine if memory is being tracked.
+	*
+	* @returns True if memory tracking is enabled.
+	*/
+	bool MemoryTrackingEnabled();
+	/**
+	* Determine if this build counts heap allocations. Counting replaces the global operator
+	* new and delete, so it is only compiled in when TEXTEXTRACT_COUNT_ALLOCATIONS is defined.
+	*
+	* @returns True if heap allocations can be counted.
+	*/
+	bool AllocationCountingAvailable();
+	/**
+	* Get the total number of bytes allocated while counting was enabled.
+	*
+	* @returns Bytes allocated through operator new.
+	*/
+	uint64_t GetAllocatedBytes();
+	/**
+	* Get the number of bytes allocated, less those released, while counting was enabled.
+	* Releasing memory allocated before counting started can make this negative.
+	*
+	* @returns Bytes currently held through operator new.
+	*/
+	int64_t GetLiveBytes();
+	/**
+	* Note the size of a pdfium bitmap allocated for rendering, keeping the largest
+	* since the last call to ResetBitmapBytes.
+	*
+	* @param bytes Size of the bitmap buffer in bytes.
+	*/
+	void RecordBitmapBytes(size_t bytes);
+	/**
+	* Get the size of the largest pdfium bitmap noted since the last reset.
+	*
+	* @returns Size of the bitmap buffer in bytes.
+	*/
+	size_t GetBitmapBytes();
+	/**
+	* Forget the bitmap sizes noted so far, usually at the start of a page.
+	*/
+	void ResetBitmapBytes();
+	/**
+	* Read the current and peak resident set size, from /proc/self/status on Linux or
+	* the process memory counters on Windows.
+	*
+	* @returns The resident memory of the process, zero if unavailable.
+	*/
+	ProcessMemory ReadProcessMemory();
+	/**
+	* Read the proportional set size of the process from /proc/self/smaps_rollup, which
+	* divides each shared page between the processes mapping it. Summed over processes
+	* forked from a common parent it gives their real combined memory use, where the
+	* resident set sizes count shared pages once per process. Linux only.
+	*
+	* @returns Proportional set size in bytes, zero if unavailable.
+	*/
+	uint64_t ReadProportionalSetSize();
+	/**
+	* Read the resident set size of another process from /proc/<pid>/status. Linux only.
+	*
+	* @param pid Process id of the process.
+	*
+	* @returns Resident set size in bytes, zero if unavailable.
+	*/
+	uint64_t ReadResidentSetSize(int pid);
+	/**
+	* Read the memory that can still be allocated without swapping: MemAvailable from
+	* /proc/meminfo on Linux, lowered to the room left under the cgroup memory limit when
+	* running in a limited cgroup, or the available physical memory on Windows.
+	*
+	* @returns Available memory in bytes, zero if unavailable.
+	*/
+	uint64_t ReadAvailableMemory();
+} // namespace textextract
+#endif
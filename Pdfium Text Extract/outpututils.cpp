@@ -1,6 +1,7 @@
 #include "outpututils.h"
 
 #include "pdfpageinfo.h"
+#include "stagetimer.h"
 
 #include <fstream>
 #include <iostream>
@@ -8,50 +9,76 @@
 #include <nlohmann/json.hpp>
 
 namespace textextract {
-	void WriteTextFile(std::string writeLocation) {
-		std::ofstream fs(writeLocation);
-		auto rawtext = boost::locale::conv::utf_to_utf<char>(GetRawPageText());
-		if (!fs) {
-			std::cerr << "Error opening the file to write text." << std::endl;
-			exit(0);
-		}
-		fs << rawtext;
-		fs.close();
-	}
-
-	void WriteJSON(std::string writeLocation) {
-		nlohmann::json j;
-		j["render_size"] = {
-			{"width", std::to_string(GetPageRender().cols)},
-			{"height", std::to_string(GetPageRender().rows)},
-		};
-		nlohmann::json jArray = nlohmann::json::array();
-		for (const auto& tb : GetPageWords()) {
-			nlohmann::json wordObject;
-			wordObject["wordtoken"] = boost::locale::conv::utf_to_utf<char>(tb.GetText());
-			wordObject["bounds"] = {
-				{"x", std::to_string(tb.GetBounds().x)},
-				{"y", std::to_string(tb.GetBounds().y)},
-				{"width", std::to_string(tb.GetBounds().width)},
-				{"height", std::to_string(tb.GetBounds().height)}
+	namespace {
+		std::string SerializeJSON() {
+			nlohmann::json j;
+			j["render_size"] = {
+				{"width", std::to_string(GetRenderDimensions().width)},
+				{"height", std::to_string(GetRenderDimensions().height)},
 			};
-			jArray.push_back(wordObject);
-		}
-		std::ofstream file(writeLocation);
-		if (file.is_open()) {
-			file << j.dump(4);
-			file << jArray.dump(4);
-			file.close();
+			j["render_status"] = RenderStatusToString(GetRenderStatus());
+			j["render_dpi"] = GetRenderDpi();
+			j["render_scale"] = GetRenderScale();
+			j["page_class"] = PageClassToString(GetPageClass());
+			if (GetRenderStatus() == RenderStatus::PASSTHROUGH) {
+				PassthroughImage image = GetPassthroughImage();
+				j["passthrough_image"] = {
+					{"file", image.path.filename().string()},
+					{"filter", image.filter},
+					{"width", image.width},
+					{"height", image.height},
+					{"bits_per_pixel", image.bitsPerPixel},
+					{"colorspace", image.colorspace},
+					{"matrix", { image.matrix.a, image.matrix.b, image.matrix.c,
+						image.matrix.d, image.matrix.e, image.matrix.f }},
+					{"page_rotation", static_cast<int>(GetPageRotation()) * 90}
+				};
+			}
+			nlohmann::json jArray = nlohmann::json::array();
+			for (const auto& tb : GetPageWords()) {
+				nlohmann::json wordObject;
+				wordObject["wordtoken"] = boost::locale::conv::utf_to_utf<char>(tb.GetText());
+				wordObject["bounds"] = {
+					{"x", std::to_string(tb.GetBounds().x)},
+					{"y", std::to_string(tb.GetBounds().y)},
+					{"width", std::to_string(tb.GetBounds().width)},
+					{"height", std::to_string(tb.GetBounds().height)}
+				};
+				jArray.push_back(wordObject);
+			}
+			return j.dump(4) + jArray.dump(4);
 		}
+	} // namespace
+
+	bool WriteJSON(std::string writeLocation) {
+		return WriteOutputFile(writeLocation, SerializeJSON());
 	}
 
-	void WriteOutput(std::filesystem::path writeLocation, int pageNum, std::string fileName, bool textOnly) {
-		std::cout << "writing output for page: " + std::to_string(pageNum) << std::endl;
+	std::string SerializeOutput(bool textOnly) {
+		ScopedStageTimer timer(Stage::SERIALIZE);
 		if (textOnly) {
-			WriteTextFile(writeLocation.string() + "\\" + fileName + "pg" + std::to_string(pageNum) + ".txt");
+			return boost::locale::conv::utf_to_utf<char>(GetRawPageText());
 		}
 		else {
-			WriteJSON(writeLocation.string() + "\\" + fileName + "pg" + std::to_string(pageNum) + ".json");
+			return SerializeJSON();
 		}
 	}
+
+	bool WriteOutputFile(const std::filesystem::path& outputPath, const std::string& contents) {
+		ScopedStageTimer timer(Stage::WRITE_OUTPUT);
+		std::ofstream file(outputPath);
+		if (!file.is_open()) {
+			std::cerr << "Error opening the output file to write: " << outputPath.string() << std::endl;
+			return false;
+		}
+		file << contents;
+		file.close();
+		return !file.fail();
+	}
+
+	std::filesystem::path GetOutputPath(
+		const std::filesystem::path& writeLocation, int pageNum, const std::string& fileName, bool textOnly) {
+		return writeLocation.string() + "\\" + fileName + "pg" + std::to_string(pageNum) +
+			(textOnly ? ".txt" : ".json");
+	}
 } // namespace textextract
@@ -1,17 +1,47 @@
 #ifndef OUTPUT_UTILS
 #define OUTPUT_UTILS
 #include <filesystem>
+#include <string>
 
 namespace textextract {
 	/**
-	* Write the result of the text extraction to file.
+	* Write the words, bounds and render details of the current page to a JSON file.
+	*
+	* @param writeLocation Path of the JSON file to write.
+	*
+	* @returns True if the file was written.
+	*/
+	bool WriteJSON(std::string writeLocation);
+	/**
+	* Serialize the current page to the contents of its result file, as JSON or as the
+	* raw text only.
+	*
+	* @param textOnly Boolean indicating whether or not bounds should be omitted from the result.
+	*
+	* @returns The contents of the result file.
+	*/
+	std::string SerializeOutput(bool textOnly);
+	/**
+	* Write serialized results to a file.
+	*
+	* @param outputPath Path of the file to write.
+	* @param contents Contents returned by SerializeOutput.
+	*
+	* @returns True if the file was written.
+	*/
+	bool WriteOutputFile(const std::filesystem::path& outputPath, const std::string& contents);
+	/**
+	* Get the path of the file the result of a page's text extraction is written to.
 	*
 	* @param writeLocation Path to the write location for the result.
 	* @param pageNum Page number of the text extraction result.
 	* @param fileName Name of the original file, used as the name for the extraction result file.
-	* @param textOnly Boolean indicating whether or not bounds should be omitted from the result.
+	* @param textOnly Boolean indicating whether or not bounds are omitted from the result.
+	*
+	* @returns Path of the result file.
 	*/
-	void WriteOutput(std::filesystem::path writeLocation, int pageNum, std::string fileName, bool textOnly);
+	std::filesystem::path GetOutputPath(
+		const std::filesystem::path& writeLocation, int pageNum, const std::string& fileName, bool textOnly);
 } // namespace textextract
 
 #endif
@@ -0,0 +1,70 @@
+#include "pageclassifier.h"
+
+#include "pdfium/fpdf_edit.h"
+
+#include <algorithm>
+
+namespace textextract {
+	namespace {
+		// Fraction of the page that images have to cover for a page without text to be
+		// treated as a full page image.
+		const double FULL_PAGE_IMAGE_COVERAGE = 0.5;
+		// Deepest nesting of form objects searched for images.
+		const int MAX_FORM_DEPTH = 4;
+
+		bool ContainsImage(FPDF_PAGEOBJECT formObject, int depth) {
+			if (depth > MAX_FORM_DEPTH) return false;
+			int count = FPDFFormObj_CountObjects(formObject);
+			for (int i = 0; i < count; i++) {
+				FPDF_PAGEOBJECT object = FPDFFormObj_GetObject(formObject, i);
+				int type = FPDFPageObj_GetType(object);
+				if (type == FPDF_PAGEOBJ_IMAGE) return true;
+				if (type == FPDF_PAGEOBJ_FORM && ContainsImage(object, depth + 1)) return true;
+			}
+			return false;
+		}
+
+		double GetObjectArea(FPDF_PAGEOBJECT object) {
+			float left = 0, bottom = 0, right = 0, top = 0;
+			if (!FPDFPageObj_GetBounds(object, &left, &bottom, &right, &top)) return 0.0;
+			return std::max(0.0f, right - left) * std::max(0.0f, top - bottom);
+		}
+	} // namespace
+
+	std::string PageClassToString(PageClass pageClass) {
+		switch (pageClass) {
+		case PageClass::NO_TEXT: return "no_text";
+		case PageClass::TEXT_ONLY: return "text_only";
+		case PageClass::MIXED: return "mixed";
+		case PageClass::IMAGE_ONLY: return "image_only";
+		default: return "none";
+		}
+	}
+
+	PageClass ClassifyPage(FPDF_PAGE page, int charCount) {
+		bool hasimage = false;
+		double imagearea = 0.0;
+		int count = FPDFPage_CountObjects(page);
+		for (int i = 0; i < count; i++) {
+			FPDF_PAGEOBJECT object = FPDFPage_GetObject(page, i);
+			int type = FPDFPageObj_GetType(object);
+			// Images drawn through a form object are counted with the bounds of the form.
+			if (type == FPDF_PAGEOBJ_IMAGE ||
+				(type == FPDF_PAGEOBJ_FORM && ContainsImage(object, 1))) {
+				hasimage = true;
+				// The area of a page with text does not change its class.
+				if (charCount > 0) break;
+				imagearea += GetObjectArea(object);
+			}
+		}
+
+		if (charCount > 0) {
+			return hasimage ? PageClass::MIXED : PageClass::TEXT_ONLY;
+		}
+		double pagearea = static_cast<double>(FPDF_GetPageWidthF(page)) * FPDF_GetPageHeightF(page);
+		if (hasimage && pagearea > 0 && imagearea >= FULL_PAGE_IMAGE_COVERAGE * pagearea) {
+			return PageClass::IMAGE_ONLY;
+		}
+		return PageClass::NO_TEXT;
+	}
+} // namespace textextract
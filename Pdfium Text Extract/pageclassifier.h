@@ -0,0 +1,41 @@
+#ifndef PAGE_CLASSIFIER
+#define PAGE_CLASSIFIER
+
+#include <string>
+
+#include "pdfium/fpdfview.h"
+
+namespace textextract {
+	// Kind of content on a page, deciding which extraction stages the page needs.
+	enum class PageClass {
+		NONE = 0,
+		// No text layer and no full page image, such as blank or vector only pages.
+		NO_TEXT = 1,
+		// A text layer and no images.
+		TEXT_ONLY = 2,
+		// A text layer along with images, such as a scan with an OCR text layer.
+		MIXED = 3,
+		// No text layer and images covering most of the page, such as a scan.
+		IMAGE_ONLY = 4
+	};
+
+	/**
+	* Get the name of a page class, as written to the output.
+	*
+	* @param pageClass The page class to name.
+	*
+	* @returns The name of the page class.
+	*/
+	std::string PageClassToString(PageClass pageClass);
+	/**
+	* Classify a page from the number of characters in its text layer and the types and
+	* bounds of its page objects, without rendering it.
+	*
+	* @param page The loaded page.
+	* @param charCount Number of characters in the page's text layer.
+	*
+	* @returns The class of the page.
+	*/
+	PageClass ClassifyPage(FPDF_PAGE page, int charCount);
+} // namespace textextract
+#endif
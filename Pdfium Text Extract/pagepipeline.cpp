@@ -0,0 +1,137 @@
+#include "pagepipeline.h"
+
+#include "pdfpageinfo.h"
+#include "tracewriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace textextract {
+	namespace {
+		typedef std::chrono::steady_clock Clock;
+
+		// A page handed from the pdfium thread to a serializing thread.
+		struct ExtractedPage {
+			PageResult result;
+			PageInfo info;
+		};
+
+		// A page handed from a serializing thread to the writer.
+		struct SerializedPage {
+			PageResult result;
+			std::string contents;
+		};
+
+		double MillisecondsSince(Clock::time_point start) {
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		nlohmann::json QueueStatsToJson(const QueueStats& stats) {
+			nlohmann::json j;
+			j["capacity"] = stats.capacity;
+			j["max_depth"] = stats.maxDepth;
+			j["mean_depth"] = stats.pushes > 0 ? static_cast<double>(stats.depthSum) / stats.pushes : 0.0;
+			j["push_wait_ms"] = stats.pushWaitMs;
+			j["pop_wait_ms"] = stats.popWaitMs;
+			return j;
+		}
+	} // namespace
+
+	nlohmann::json PipelineReportToJson(const PipelineReport& report) {
+		nlohmann::json j;
+		j["elapsed_ms"] = report.elapsedMs;
+		nlohmann::json stages = nlohmann::json::array();
+		for (const auto& stage : report.stages) {
+			nlohmann::json s;
+			s["name"] = stage.name;
+			s["threads"] = stage.threads;
+			s["pages"] = stage.pages;
+			s["busy_ms"] = stage.busyMs;
+			s["utilization"] = report.elapsedMs > 0.0 ?
+				stage.busyMs / (report.elapsedMs * stage.threads) : 0.0;
+			stages.push_back(s);
+		}
+		j["stages"] = stages;
+		j["queues"] = {
+			{"extracted", QueueStatsToJson(report.extracted)},
+			{"serialized", QueueStatsToJson(report.serialized)}
+		};
+		return j;
+	}
+
+	void RunPagePipeline(const std::vector<int>& pages, const PipelineSettings& settings,
+		const PageExtractor& extract, const PageSerializer& serialize, const PageWriter& write,
+		std::vector<PageResult>& results, PipelineReport& report) {
+		results.clear();
+		report = PipelineReport();
+		int serializethreads = std::max(settings.serializeThreads, 1);
+		BoundedQueue<ExtractedPage> extracted(settings.queueDepth);
+		BoundedQueue<SerializedPage> serialized(settings.queueDepth);
+		PipelineStageReport extractstage{ "extract", 1 };
+		PipelineStageReport serializestage{ "serialize", serializethreads };
+		PipelineStageReport writestage{ "write", 1 };
+		std::mutex stagemutex;
+		std::atomic<int> serializersrunning(serializethreads);
+		auto start = Clock::now();
+
+		std::vector<std::thread> serializers;
+		for (int i = 0; i < serializethreads; i++) {
+			serializers.emplace_back([&]() {
+				double busyms = 0.0;
+				int pagecount = 0;
+				ExtractedPage page;
+				while (extracted.Pop(page)) {
+					auto pagestart = Clock::now();
+					SetTracePage(page.result.pageNumber);
+					RestorePageInfo(std::move(page.info));
+					std::string contents = serialize(page.result);
+					ClearPageInfo();
+					busyms += MillisecondsSince(pagestart);
+					pagecount++;
+					serialized.Push({ page.result, std::move(contents) });
+				}
+				{
+					std::lock_guard<std::mutex> lock(stagemutex);
+					serializestage.busyMs += busyms;
+					serializestage.pages += pagecount;
+				}
+				// The last serializer to finish lets the writer know no more pages are coming.
+				if (--serializersrunning == 0) serialized.Close();
+			});
+		}
+		std::thread writer([&]() {
+			SerializedPage page;
+			while (serialized.Pop(page)) {
+				auto pagestart = Clock::now();
+				SetTracePage(page.result.pageNumber);
+				write(page.result, page.contents);
+				results.push_back(page.result);
+				writestage.busyMs += MillisecondsSince(pagestart);
+				writestage.pages++;
+			}
+		});
+
+		for (int pagenumber : pages) {
+			auto pagestart = Clock::now();
+			ExtractedPage page;
+			page.result = extract(pagenumber);
+			page.info = TakePageInfo();
+			extractstage.busyMs += MillisecondsSince(pagestart);
+			extractstage.pages++;
+			extracted.Push(std::move(page));
+		}
+		extracted.Close();
+		for (auto& serializer : serializers) serializer.join();
+		writer.join();
+
+		report.elapsedMs = MillisecondsSince(start);
+		report.stages = { extractstage, serializestage, writestage };
+		report.extracted = extracted.GetStats();
+		report.serialized = serialized.GetStats();
+		std::sort(results.begin(), results.end(),
+			[](const PageResult& a, const PageResult& b) { return a.pageNumber < b.pageNumber; });
+	}
+} // namespace textextract
@@ -0,0 +1,84 @@
+#ifndef PAGE_PIPELINE
+#define PAGE_PIPELINE
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "boundedqueue.h"
+#include "pageresult.h"
+
+namespace textextract {
+	/**
+	* @brief Number of threads and queue sizes of the page pipeline.
+	*/
+	struct PipelineSettings {
+		// Threads serializing page results, next to the single pdfium thread and the writer.
+		int serializeThreads = 2;
+		// Pages each queue between stages can hold before the stage feeding it waits.
+		int queueDepth = 4;
+	};
+
+	/**
+	* @brief Time a pipeline stage spent working, summed over its threads.
+	*/
+	struct PipelineStageReport {
+		std::string name;
+		int threads = 1;
+		int pages = 0;
+		double busyMs = 0.0;
+	};
+
+	/**
+	* @brief How the stages of a page pipeline ran, and how full the queues between them got.
+	*/
+	struct PipelineReport {
+		// Time from the first page being extracted until the last page was written, in milliseconds.
+		double elapsedMs = 0.0;
+		std::vector<PipelineStageReport> stages;
+		// Queue of extracted pages waiting to be serialized.
+		QueueStats extracted;
+		// Queue of serialized pages waiting to be written.
+		QueueStats serialized;
+	};
+
+	/**
+	* Convert the pipeline report to JSON, with the utilization of each stage as the
+	* fraction of its threads' time spent working.
+	*
+	* @param report The pipeline report.
+	*
+	* @returns The report as JSON.
+	*/
+	nlohmann::json PipelineReportToJson(const PipelineReport& report);
+
+	// Extracts a page with pdfium, leaving it as the current page information.
+	using PageExtractor = std::function<PageResult(int pageNumber)>;
+	// Serializes the current page information to the contents of the page's result file.
+	using PageSerializer = std::function<std::string(PageResult& result)>;
+	// Writes the serialized contents of a page and records its result.
+	using PageWriter = std::function<void(PageResult& result, const std::string& contents)>;
+
+	/**
+	* Process pages as a pipeline of three stages joined by bounded queues, so that the
+	* next pages are extracted while earlier ones are serialized and written. Extraction
+	* runs on the calling thread, since pdfium must only be used from one thread at a time.
+	* Serialization runs on a pool of threads, each taking over the page information of
+	* the page it serializes, and a single writer thread writes the pages out in the order
+	* they are serialized.
+	*
+	* @param pages Page numbers of the pages to process.
+	* @param settings Number of serializing threads and the queue depth.
+	* @param extract Extracts a page, called on the calling thread.
+	* @param serialize Serializes a page, called on the serializing threads.
+	* @param write Writes a page, called on the writer thread.
+	* @param results Set to the results of the pages, in page order.
+	* @param report Set to the stage utilization and queue depths.
+	*/
+	void RunPagePipeline(const std::vector<int>& pages, const PipelineSettings& settings,
+		const PageExtractor& extract, const PageSerializer& serialize, const PageWriter& write,
+		std::vector<PageResult>& results, PipelineReport& report);
+} // namespace textextract
+#endif
@@ -1,7 +1,6 @@
 #include "pagerange.h"
 
-#include <vector>
-#include <iostream>
+#include <algorithm>
 #include <sstream>
 
 namespace textextract {
@@ -24,60 +23,104 @@ namespace textextract {
 
 	// Determine if the token is a valid number.
 	bool isValidNumber(const std::string& str) {
-		if (str.empty()) return false;
+		if (str.empty() || str.size() > 9) return false;
 		return str.find_first_not_of("0123456789") == std::string::npos;
 	}
 
-	void PageRange::ParsePageRange(const std::string& pageRange, int pageCount) {
-		std::string cleaned = removeSpaces(pageRange);
-		try {
-			// Single page
-			if (cleaned.find('-') == std::string::npos) {
-				if (cleaned == "0") {
-					firstpage = 1;
-					lastpage = pageCount;
-					return;
-				}
-				if (isValidNumber(cleaned)) {
-					int singlepage = std::stoi(cleaned);
-					if (singlepage > pageCount) {
-						throw singlepage;
-					}
-					firstpage = singlepage;
-					lastpage = singlepage;
-					return;
-				}
-				else {
-					throw cleaned;
+	// Resolve a page token, which counts back from the last page when negative, to a page number.
+	bool resolvePage(const std::string& token, int pageCount, int& page, std::string& error) {
+		bool fromEnd = !token.empty() && token[0] == '-';
+		std::string digits = fromEnd ? token.substr(1) : token;
+		if (!isValidNumber(digits)) {
+			error = "Invalid page number: " + token;
+			return false;
+		}
+		int number = std::stoi(digits);
+		page = fromEnd ? pageCount + 1 - number : number;
+		if (number == 0 || page < 1 || page > pageCount) {
+			error = "Page " + token + " is outside the " + std::to_string(pageCount) + " pages in the pdf.";
+			return false;
+		}
+		return true;
+	}
+
+	// Add the pages selected by one item of the expression.
+	bool addPageSetItem(const std::string& item, int pageCount, std::vector<int>& pages, std::string& error) {
+		std::string range = item;
+		int step = 1;
+		size_t slash = item.find('/');
+		if (slash != std::string::npos) {
+			std::string stride = item.substr(slash + 1);
+			if (!isValidNumber(stride) || std::stoi(stride) < 1) {
+				error = "Invalid page step: " + item;
+				return false;
+			}
+			step = std::stoi(stride);
+			range = item.substr(0, slash);
+		}
+
+		int first = 1;
+		int last = pageCount;
+		size_t colon = range.find(':');
+		if (colon != std::string::npos) {
+			std::string which = range.substr(0, colon);
+			std::string count = range.substr(colon + 1);
+			if ((which != "first" && which != "last") || !isValidNumber(count)) {
+				error = "Invalid page set: " + item;
+				return false;
+			}
+			int n = std::min(std::stoi(count), pageCount);
+			if (which == "first") last = n;
+			else first = pageCount - n + 1;
+		}
+		else if (range != "0" && range != "all") {
+			// The range separator is the first '-' that is not the sign of the first page.
+			size_t dash = range.find('-', 1);
+			if (dash == std::string::npos) {
+				if (slash != std::string::npos) {
+					error = "A page step needs a range of pages: " + item;
+					return false;
 				}
+				if (!resolvePage(range, pageCount, first, error)) return false;
+				last = first;
 			}
-			// Multiple pages
 			else {
-				std::vector<std::string> parts = split(cleaned, '-');
-				if (parts.size() != 2) {
-					throw cleaned;
-				}
-				if (!isValidNumber(parts[0]) || !isValidNumber(parts[1])) {
-					throw cleaned;
+				if (!resolvePage(range.substr(0, dash), pageCount, first, error)) return false;
+				std::string end = range.substr(dash + 1);
+				if (!end.empty() && !resolvePage(end, pageCount, last, error)) return false;
+				if (last < first) {
+					error = "Page range ends before it starts: " + item;
+					return false;
 				}
-
-				int start = std::stoi(parts[0]);
-				int end = std::stoi(parts[1]);
-				if (start > pageCount || start < 1) throw start;
-				if (end > pageCount || end < 1) throw end;
-				firstpage = start;
-				lastpage = end;
 			}
 		}
-		catch (std::string invalidRange) {
-			std::cerr << "Invaild page range: " + invalidRange << std::endl;
-			std::cerr << "Page range must either be a single positive integer, or range written as <first_page>-<last_page>" << std::endl;
-			std::exit(EXIT_FAILURE);
+
+		for (int page = first; page <= last; page += step) {
+			pages.push_back(page);
+		}
+		return true;
+	}
+
+	bool PageRange::ParsePageRange(const std::string& pageRange, int pageCount, std::string& error) {
+		pages.clear();
+		std::string cleaned = removeSpaces(pageRange);
+		if (cleaned.empty()) {
+			error = "Page range is empty.";
+			return false;
+		}
+		for (const std::string& item : split(cleaned, ',')) {
+			if (item.empty()) continue;
+			if (!addPageSetItem(item, pageCount, pages, error)) {
+				pages.clear();
+				return false;
+			}
 		}
-		catch (int pageNum) {
-			std::cerr << "Invalid page index: " + std::to_string(pageNum) << std::endl;
-			std::cerr << "Page Index is outside number of pages in pdf." << std::endl;
-			std::exit(EXIT_FAILURE);
+		std::sort(pages.begin(), pages.end());
+		pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+		if (pages.empty()) {
+			error = "Page range selects no pages: " + pageRange;
+			return false;
 		}
+		return true;
 	}
 } // namespace textextract
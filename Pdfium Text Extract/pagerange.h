@@ -2,23 +2,37 @@
 #define PAGE_RANGE
 
 #include <string>
+#include <vector>
 
 namespace textextract {
+	/**
+	* A set of pages to process, compiled from a page set expression into a sorted list
+	* without duplicates, so that the document can be walked once from front to back.
+	*
+	* An expression is a comma separated list of items, each of which is one of:
+	*   0 or all      every page of the document
+	*   N             a single page, where -N counts back from the last page (-1 is the last)
+	*   A-B           the pages A to B inclusive, either of which may be negative
+	*   A-            the pages from A to the end of the document
+	*   first:N       the first N pages
+	*   last:N        the last N pages
+	* A range, or all, may be followed by /S to take every S-th page, such as 1-/2 for the
+	* odd pages or all/10 for every tenth page.
+	*/
 	struct PageRange {
-		// Page number of the first page of the range to be processed.
-		int firstpage = 0;
-		// Page number of the last page of the range to be processed.
-		int lastpage = 0;
+		// Page numbers of the pages to be processed, in ascending order.
+		std::vector<int> pages;
 
 		/**
-		* Get the render data for the current page.
+		* Compile a page set expression into the list of pages.
 		*
-		* @param pageRange String representing the range of pages to parse.
-		* @param pageCount total page count for the document, to ensure page range is logical.
+		* @param pageRange String holding the page set expression.
+		* @param pageCount Total page count for the document, to ensure the pages are logical.
+		* @param error Set to a description of the problem when the expression is invalid.
+		*
+		* @returns True if the expression was valid for the document.
 		*/
-		void ParsePageRange(const std::string& pageRange, int pageCount);
-
-		PageRange(std::string pageRange, int pageCount) { ParsePageRange(pageRange, pageCount); }
+		bool ParsePageRange(const std::string& pageRange, int pageCount, std::string& error);
 	};
 } // namespace textextract
 #endif
@@ -0,0 +1,78 @@
+#include "pageresult.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace textextract {
+	std::string PageStatusToString(PageStatus status) {
+		switch (status) {
+		case PageStatus::DEGRADED: return "degraded";
+		case PageStatus::FAILED: return "failed";
+		default: return "ok";
+		}
+	}
+
+	void PageResult::Degrade(const std::string& stage, const std::string& reason) {
+		if (status == PageStatus::OK) status = PageStatus::DEGRADED;
+		reasons.push_back(stage + ": " + reason);
+	}
+
+	void PageResult::Fail(const std::string& stage, const std::string& reason) {
+		status = PageStatus::FAILED;
+		reasons.push_back(stage + ": " + reason);
+	}
+
+	bool DocumentResult::AnyFailed() const {
+		if (!error.empty()) return true;
+		for (const auto& page : pages) {
+			if (page.status == PageStatus::FAILED) return true;
+		}
+		return false;
+	}
+
+	bool WritePageReport(const std::filesystem::path& writeLocation, const std::vector<DocumentResult>& documents,
+		const nlohmann::json& supervisor) {
+		int totals[3] = { 0, 0, 0 };
+		nlohmann::json documentsjson = nlohmann::json::array();
+		for (const auto& document : documents) {
+			int counts[3] = { 0, 0, 0 };
+			nlohmann::json pages = nlohmann::json::array();
+			for (const auto& result : document.pages) {
+				counts[static_cast<int>(result.status)]++;
+				totals[static_cast<int>(result.status)]++;
+				// Only pages that need attention are listed, to keep reports of large documents small.
+				if (result.status == PageStatus::OK) continue;
+				pages.push_back({
+					{"page", result.pageNumber},
+					{"status", PageStatusToString(result.status)},
+					{"reasons", result.reasons} });
+			}
+			nlohmann::json j;
+			j["file"] = document.fileName;
+			if (!document.error.empty()) j["error"] = document.error;
+			if (document.skipped) j["skipped"] = true;
+			j["pages_processed"] = document.pages.size();
+			j["pages_skipped"] = document.pagesSkipped;
+			j["ok"] = counts[static_cast<int>(PageStatus::OK)];
+			j["degraded"] = counts[static_cast<int>(PageStatus::DEGRADED)];
+			j["failed"] = counts[static_cast<int>(PageStatus::FAILED)];
+			if (!document.pageWorkers.is_null()) j["page_workers"] = document.pageWorkers;
+			j["pages"] = pages;
+			documentsjson.push_back(j);
+		}
+		nlohmann::json report;
+		report["ok"] = totals[static_cast<int>(PageStatus::OK)];
+		report["degraded"] = totals[static_cast<int>(PageStatus::DEGRADED)];
+		report["failed"] = totals[static_cast<int>(PageStatus::FAILED)];
+		if (!supervisor.is_null()) report["supervisor"] = supervisor;
+		report["documents"] = documentsjson;
+
+		std::ofstream file(writeLocation);
+		if (!file.is_open()) {
+			std::cerr << "Error opening the page report file: " << writeLocation.string() << std::endl;
+			return false;
+		}
+		file << report.dump(4);
+		return true;
+	}
+} // namespace textextract
@@ -0,0 +1,118 @@
+#ifndef PAGE_RESULT
+#define PAGE_RESULT
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace textextract {
+	// Outcome of processing a single page.
+	enum class PageStatus {
+		OK = 0,
+		// The page was processed, but part of its output is missing or reduced, such as a
+		// partial render or a text layer that failed to load.
+		DEGRADED = 1,
+		// Nothing could be extracted from the page.
+		FAILED = 2
+	};
+
+	/**
+	* Convert the page status to the name used in the page report.
+	*
+	* @param status The page status.
+	*
+	* @returns Name of the status.
+	*/
+	std::string PageStatusToString(PageStatus status);
+
+	/**
+	* @brief Status of a processed page and the reasons it was not processed cleanly.
+	*/
+	struct PageResult {
+		// One based page number.
+		int pageNumber = 0;
+		PageStatus status = PageStatus::OK;
+		// Reasons for a degraded or failed status, each prefixed with the stage it came from.
+		std::vector<std::string> reasons;
+
+		/**
+		* Mark the page as degraded, unless it already failed.
+		*
+		* @param stage Name of the stage the problem happened in.
+		* @param reason Description of the problem.
+		*/
+		void Degrade(const std::string& stage, const std::string& reason);
+		/**
+		* Mark the page as failed.
+		*
+		* @param stage Name of the stage the problem happened in.
+		* @param reason Description of the problem.
+		*/
+		void Fail(const std::string& stage, const std::string& reason);
+	};
+
+	/**
+	* @brief Results of the pages processed from one document.
+	*/
+	struct DocumentResult {
+		// Name of the document file.
+		std::string fileName;
+		// Reason the document could not be processed at all, empty if it was.
+		std::string error;
+		// Whether or not the document was skipped as already complete.
+		bool skipped = false;
+		// Number of pages skipped because their output was already written.
+		int pagesSkipped = 0;
+		// Results of the processed pages.
+		std::vector<PageResult> pages;
+		// Startup time and memory use of the page workers, null when the pages were processed
+		// in a single process.
+		nlohmann::json pageWorkers;
+
+		/**
+		* Check whether the document failed to load, or any of its pages failed.
+		*
+		* @returns True if anything failed.
+		*/
+		bool AnyFailed() const;
+	};
+
+	/**
+	* @brief Receives the progress of a document while it is processed, so that the
+	* caller knows which page is being worked on.
+	*/
+	class PageProgress {
+	public:
+		virtual ~PageProgress() = default;
+		/**
+		* Called before a page is processed.
+		*
+		* @param pageNumber One based page number.
+		*/
+		virtual void PageStarted(int pageNumber) = 0;
+		/**
+		* Called once a page is processed, or reported as failed without processing.
+		*
+		* @param result Result of the page.
+		*/
+		virtual void PageFinished(const PageResult& result) = 0;
+	};
+
+	/**
+	* Write the status of every processed page to a JSON report, with counts of the ok,
+	* degraded and failed pages of each document, and the reasons of each page that was
+	* not ok.
+	*
+	* @param writeLocation Path of the JSON file to write.
+	* @param documents Results of the processed documents.
+	* @param supervisor Worker restarts and quarantined pages when documents were processed by
+	* worker processes, null otherwise.
+	*
+	* @returns True if the file was written.
+	*/
+	bool WritePageReport(const std::filesystem::path& writeLocation, const std::vector<DocumentResult>& documents,
+		const nlohmann::json& supervisor = nullptr);
+} // namespace textextract
+#endif
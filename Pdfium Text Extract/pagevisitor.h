@@ -0,0 +1,119 @@
+#ifndef PAGE_VISITOR
+#define PAGE_VISITOR
+
+#include <cstddef>
+#include <string>
+
+#include <opencv2/core/mat.hpp>
+
+#include "pageclassifier.h"
+#include "pageresult.h"
+#include "renderoptions.h"
+#include "textbox.h"
+
+namespace textextract {
+	/**
+	* @brief What is known about a page before its contents are streamed.
+	*/
+	struct PageStart {
+		// One based page number.
+		int pageNumber = 0;
+		// Size of the page in points.
+		double width = 0.0;
+		double height = 0.0;
+		PageRotation rotation = PageRotation::NO_ROTATION;
+		PageClass pageClass = PageClass::NONE;
+		// Number of characters in the page's text layer.
+		int charCount = 0;
+		// Resolution and size of the render, which word and line bounds are given in.
+		int renderDpi = 0;
+		PageDimensions renderDimensions;
+	};
+
+	/**
+	* @brief Which parts of a page are streamed, and in what size pieces.
+	*/
+	struct StreamOptions {
+		// Resolution, profile, render deadline and regions of interest, as for GetPageInfo.
+		RenderOptions render;
+		// Whether or not the page is rendered and passed on in tiles.
+		bool renderTiles = false;
+		// Rows in each render tile, which bounds the memory held for the render.
+		int tileHeight = 256;
+		// Characters in each raw text chunk.
+		size_t rawTextChunkChars = 4096;
+	};
+
+	/**
+	* @brief Receives the contents of a page as they are produced, instead of after the
+	* whole page has been gathered. Only the piece being delivered is held in memory, so
+	* a page with hundreds of thousands of words is processed in constant memory.
+	*
+	* For each page OnPageBegin is called first, then the raw text in chunks, then the
+	* words in reading order with OnLine after the last word of each line, then the render
+	* tiles from the top of the page down when requested, and OnPageEnd last. A page that
+	* fails to load still gets OnPageBegin, with only its page number set. Every
+	* callback does nothing by default, so a visitor only overrides what it needs. The
+	* arguments are only valid for the duration of the call.
+	*/
+	class PageVisitor {
+	public:
+		virtual ~PageVisitor() = default;
+		/**
+		* Called before anything else of a page is delivered.
+		*
+		* @param page Size, class and render resolution of the page.
+		*/
+		virtual void OnPageBegin(const PageStart& page) {}
+		/**
+		* Called with each chunk of the page's raw text, in order. With regions of
+		* interest, each region's text is its own chunk.
+		*
+		* @param chunk The next piece of raw text.
+		*/
+		virtual void OnRawTextChunk(const std::wstring& chunk) {}
+		/**
+		* Called with each word, in the order of the text layer. Words are split on
+		* whitespace and cleaned the same way as word tokens, but since the page is never
+		* held as a whole, watermark words are not filtered out.
+		*
+		* @param word The word and its bounds in render coordinates.
+		*/
+		virtual void OnWord(const TextBox& word) {}
+		/**
+		* Called at the end of each line of the text layer, after its last word.
+		*
+		* @param line The words of the line joined by spaces, bounded by their union.
+		*/
+		virtual void OnLine(const TextBox& line) {}
+		/**
+		* Called with each band of the render, from the top of the page down. Tiles are
+		* single channel grayscale images the width of the render.
+		*
+		* @param top Row of the render the tile starts at.
+		* @param tile Image data of the tile.
+		*/
+		virtual void OnRenderTile(int top, const cv::Mat& tile) {}
+		/**
+		* Called once the page has been fully delivered.
+		*
+		* @param result Whether the page was processed cleanly, degraded or failed, and why.
+		*/
+		virtual void OnPageEnd(const PageResult& result) {}
+	};
+
+	/**
+	* Deliver a page that failed before any of its contents could be streamed, calling
+	* OnPageBegin with only the page number and then OnPageEnd with the failure.
+	*
+	* @param visitor Visitor to deliver the page to.
+	* @param result The failed page's result.
+	*/
+	inline void VisitFailedPage(PageVisitor& visitor, const PageResult& result) {
+		PageStart start;
+		start.pageNumber = result.pageNumber;
+		visitor.OnPageBegin(start);
+		visitor.OnPageEnd(result);
+	}
+} // namespace textextract
+#endif
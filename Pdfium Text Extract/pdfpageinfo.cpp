@@ -2,58 +2,91 @@
 
 namespace textextract {
 	namespace {
-		cv::Mat mRender;
-		PageSize mPageSize;
-		PageOrientation mPageOrientation;
-		PageRotation mPageRotation;
-		std::wstring mRawPageText;
-		std::vector<TextBox> mPageWords;
+		thread_local PageInfo mPageInfo;
 	} // namespace
 
 	// Accessors
 	cv::Mat GetPageRender() {
-		return mRender;
+		return mPageInfo.render;
 	}
 	PageSize GetPageSize() {
-		return mPageSize;
+		return mPageInfo.pageSize;
 	}
 	PageRotation GetPageRotation() {
-		return mPageRotation;
+		return mPageInfo.pageRotation;
 	}
 	std::vector<TextBox> GetPageWords() {
-		return mPageWords;
+		return mPageInfo.pageWords;
 	}
 	std::wstring GetRawPageText() {
-		return mRawPageText;
+		return mPageInfo.rawPageText;
 	}
 	PageOrientation GetPageOrientation() {
-		return mPageOrientation;
+		return mPageInfo.pageOrientation;
+	}
+	PageDimensions GetRenderDimensions() {
+		return mPageInfo.renderDimensions;
+	}
+	RenderStatus GetRenderStatus() {
+		return mPageInfo.renderStatus;
+	}
+	int GetRenderDpi() {
+		return mPageInfo.renderDpi;
+	}
+	double GetRenderScale() {
+		return mPageInfo.renderDpi / 72.0;
+	}
+	PageClass GetPageClass() {
+		return mPageInfo.pageClass;
+	}
+	PassthroughImage GetPassthroughImage() {
+		return mPageInfo.passthroughImage;
 	}
 
 	// Mutators
 	void ClearPageInfo() {
-		mRender.release();
-		mPageSize = PageSize();
-		mPageRotation = PageRotation::NO_ROTATION;
-		mRawPageText.clear();
-		mPageWords.clear();
+		mPageInfo = PageInfo();
+	}
+	PageInfo TakePageInfo() {
+		PageInfo pageinfo = std::move(mPageInfo);
+		ClearPageInfo();
+		return pageinfo;
+	}
+	void RestorePageInfo(PageInfo pageInfo) {
+		mPageInfo = std::move(pageInfo);
 	}
 	void SetRender(cv::Mat render) {
-		mRender = render;
+		mPageInfo.render = render;
+		mPageInfo.renderDimensions = PageDimensions(render.cols, render.rows);
+	}
+	void SetRenderDimensions(PageDimensions renderDimensions) {
+		mPageInfo.renderDimensions = renderDimensions;
+	}
+	void SetRenderStatus(RenderStatus renderStatus) {
+		mPageInfo.renderStatus = renderStatus;
+	}
+	void SetRenderDpi(int renderDpi) {
+		mPageInfo.renderDpi = renderDpi;
+	}
+	void SetPageClass(PageClass pageClass) {
+		mPageInfo.pageClass = pageClass;
+	}
+	void SetPassthroughImage(PassthroughImage passthroughImage) {
+		mPageInfo.passthroughImage = passthroughImage;
 	}
 	void SetPageSize(int width, int height) {
-		mPageSize.DeterminePageSize(width, height);
+		mPageInfo.pageSize.DeterminePageSize(width, height);
 	}
 	void SetPageRotation(PageRotation pageRotation) {
-		mPageRotation = pageRotation;
+		mPageInfo.pageRotation = pageRotation;
 	}
 	void SetPageWords(std::vector<TextBox> pageWords) {
-		mPageWords = pageWords;
+		mPageInfo.pageWords = pageWords;
 	}
 	void SetRawPageText(std::wstring rawText) {
-		mRawPageText = rawText;
+		mPageInfo.rawPageText = rawText;
 	}
 	void SetPageOrientation(PageOrientation pageOrientation) {
-		mPageOrientation = pageOrientation;
+		mPageInfo.pageOrientation = pageOrientation;
 	}
 } // namespace textextract
\ No newline at end of file
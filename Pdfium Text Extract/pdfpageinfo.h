@@ -1,11 +1,33 @@
 #ifndef PDF_INFO
 #define PDF_INFO
 
+#include "imagepassthrough.h"
+#include "pageclassifier.h"
+#include "renderoptions.h"
 #include "textbox.h"
 
 #include <opencv2/imgcodecs.hpp>
 
 namespace textextract {
+	/**
+	* @brief Everything extracted for a single page. The current page information is kept
+	* per thread, so that a page can be handed from the thread that extracted it to the
+	* thread that writes it out.
+	*/
+	struct PageInfo {
+		cv::Mat render;
+		PageDimensions renderDimensions;
+		RenderStatus renderStatus = RenderStatus::NONE;
+		int renderDpi = 0;
+		PageClass pageClass = PageClass::NONE;
+		PassthroughImage passthroughImage;
+		PageSize pageSize;
+		PageOrientation pageOrientation;
+		PageRotation pageRotation = PageRotation::NO_ROTATION;
+		std::wstring rawPageText;
+		std::vector<TextBox> pageWords;
+	};
+
 	/**
 	* Get the render data for the current page.
 	*
@@ -31,6 +53,45 @@ namespace textextract {
 	*/
 	PageOrientation GetPageOrientation();
 	/**
+	* Get the dimensions of the page render. These are kept separately from the render
+	* itself, as a render streamed to a RenderSink is not held in memory.
+	*
+	* @returns PageDimensions of the render, in pixels.
+	*/
+	PageDimensions GetRenderDimensions();
+	/**
+	* Get the outcome of rendering the current page.
+	*
+	* @returns RenderStatus describing whether the render is complete.
+	*/
+	RenderStatus GetRenderStatus();
+	/**
+	* Get the resolution the current page was rendered at. This can differ from the
+	* requested dpi when the render budget or a render timeout lowered it.
+	*
+	* @returns The effective dots per inch of the render.
+	*/
+	int GetRenderDpi();
+	/**
+	* Get the scale from page points to render pixels for the current page.
+	*
+	* @returns Render pixels per page point.
+	*/
+	double GetRenderScale();
+	/**
+	* Get the class of the page's content, which decides the extraction stages it went through.
+	*
+	* @returns PageClass of the page.
+	*/
+	PageClass GetPageClass();
+	/**
+	* Get the embedded image written in place of the page render, when the render status
+	* is RenderStatus::PASSTHROUGH.
+	*
+	* @returns PassthroughImage of the page.
+	*/
+	PassthroughImage GetPassthroughImage();
+	/**
 	* Get the words with their bounds for a page.
 	*
 	* @returns A vector of TextBoxes.
@@ -47,12 +108,54 @@ namespace textextract {
 	*/
 	void ClearPageInfo();
 	/**
+	* Move the current page information out, leaving it cleared.
+	*
+	* @returns The information of the current page.
+	*/
+	PageInfo TakePageInfo();
+	/**
+	* Make page information taken on another thread the current page information.
+	*
+	* @param pageInfo The page information to restore.
+	*/
+	void RestorePageInfo(PageInfo pageInfo);
+	/**
 	* Set the image data for the page render.
 	*
 	* @param render The image data for the page.
 	*/
 	void SetRender(cv::Mat render);
 	/**
+	* Set the dimensions of the page render.
+	*
+	* @param renderDimensions The dimensions of the render, in pixels.
+	*/
+	void SetRenderDimensions(PageDimensions renderDimensions);
+	/**
+	* Set the outcome of rendering the page.
+	*
+	* @param renderStatus The status of the page render.
+	*/
+	void SetRenderStatus(RenderStatus renderStatus);
+	/**
+	* Set the resolution the page was rendered at.
+	*
+	* @param renderDpi The effective dots per inch of the render.
+	*/
+	void SetRenderDpi(int renderDpi);
+	/**
+	* Set the class of the page's content.
+	*
+	* @param pageClass The class of the page.
+	*/
+	void SetPageClass(PageClass pageClass);
+	/**
+	* Set the embedded image written in place of the page render.
+	*
+	* @param passthroughImage The written image.
+	*/
+	void SetPassthroughImage(PassthroughImage passthroughImage);
+	/**
 	* Set the size of the page.
 	*
 	* @param width The width of the page render.
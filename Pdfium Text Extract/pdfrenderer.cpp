@@ -1,38 +1,46 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "pdfrenderer.h"
 
+#include "rendersink.h"
+#include "stagetimer.h"
 #include "textextractutils.h"
 
 #include <opencv2/core/mat.hpp>
 #include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
 #include <algorithm>
+#include <chrono>
 
 using namespace image_diff_png;
 
 namespace textextract {
 #pragma region TextExtraction
-	std::vector<TextBox> GetTextWithBounds(FPDF_PAGE page) {
+	std::vector<TextBox> GetTextWithBounds(FPDF_TEXTPAGE textpage, const std::vector<FS_RECTF>& regions) {
 		int pagewidth = GetPageSize().GetPageDimensions().width;
 		int pageheight = GetPageSize().GetPageDimensions().height;
 		if ((pagewidth < pageheight) && GetPageOrientation() == PageOrientation::LANDSCAPE) {
 			std::swap(pagewidth, pageheight);
 		}
-		FPDF_TEXTPAGE textpage = FPDFText_LoadPage(page);
-		std::vector<std::wstring> wordtokens = GetWordTokens(GetRawPageText());
-		std::vector<TextBox> pagewordtextboxes =
-			GetTextBoxesFromTokens(wordtokens, textpage, pagewidth, pageheight);
+		std::vector<TextBox> pagewordtextboxes;
+		if (!regions.empty()) {
+			pagewordtextboxes = GetTextBoxesInRegions(textpage, regions, pagewidth, pageheight);
+		}
+		else {
+			std::vector<std::wstring> wordtokens = GetWordTokens(GetRawPageText());
+			pagewordtextboxes = GetTextBoxesFromTokens(wordtokens, textpage, pagewidth, pageheight);
+		}
 		RemoveWaterMarkText(pagewordtextboxes);
-		if (GetPageRender().rows != GetPageSize().GetPageDimensions().height
-			&& GetPageRender().cols != GetPageSize().GetPageDimensions().width) {
-			PageDimensions renderdims(GetPageRender().cols, GetPageRender().rows);
+		PageDimensions renderdims = GetRenderDimensions();
+		if (renderdims.height != GetPageSize().GetPageDimensions().height
+			&& renderdims.width != GetPageSize().GetPageDimensions().width) {
 			RescaleTextBoxes(pagewordtextboxes, GetPageSize().GetPageDimensions(), renderdims);
 		}
 		return pagewordtextboxes;
 	}
 
-	std::wstring GetTextRaw(FPDF_PAGE page) {
+	std::wstring GetTextRaw(FPDF_TEXTPAGE textpage) {
+		ScopedStageTimer timer(Stage::RAW_TEXT);
 		std::wstring rawtext;
-		FPDF_TEXTPAGE textpage = FPDFText_LoadPage(page);
 
 		for (int i = 0; i < FPDFText_CountChars(textpage); i++) {
 			rawtext += FPDFText_GetUnicode(textpage, i);
@@ -108,7 +116,12 @@ namespace textextract {
 
 	static cv::Mat
 		RenderPage(const void* buffer_void, int stride, int width, int height) {
-		if (!CheckDimensions(stride, width, height)) exit(1);
+		ScopedStageTimer timer(Stage::PNG_ROUND_TRIP);
+		if (!CheckDimensions(stride, width, height)) {
+			std::string errMsg = "Bitmap dimensions are invalid for PNG conversion.";
+			fprintf(stderr, "%s\n", errMsg.c_str());
+			return cv::Mat();
+		}
 
 		std::vector<byte> png_encoding;
 		const unsigned char* buffer =
@@ -117,7 +130,7 @@ namespace textextract {
 			buffer, width, height, stride, false, &png_encoding)) {
 			std::string errMsg = "Failed to convert bitmap to PNG.";
 			fprintf(stderr, "%s\n", errMsg.c_str());
-			exit(1);
+			return cv::Mat();
 		}
 
 		cv::Mat data_mat(png_encoding, true);
@@ -133,31 +146,259 @@ namespace textextract {
 		return dims;
 	}
 
-	cv::Mat GetPageRender(FPDF_FORMHANDLE& form, FPDF_PAGE page, int dpi) {
+	// Band height used when a page is too large to be rendered as a single bitmap.
+	static const int FALLBACK_TILE_HEIGHT = 1024;
+
+	// IFSDK_PAUSE implementation that asks pdfium to pause a progressive render once
+	// the render deadline for the page has passed.
+	struct RenderDeadline : public IFSDK_PAUSE {
+		// Point in time after which the render should be abandoned.
+		std::chrono::steady_clock::time_point deadline;
+		// Whether or not a deadline was configured.
+		bool enabled = false;
+
+		RenderDeadline(int timeoutMs) {
+			IFSDK_PAUSE::version = 1;
+			IFSDK_PAUSE::NeedToPauseNow = NeedToPause;
+			IFSDK_PAUSE::user = nullptr;
+			Restart(timeoutMs);
+		}
+		// Start a new deadline timeoutMs from now, 0 disables the deadline.
+		void Restart(int timeoutMs) {
+			enabled = timeoutMs > 0;
+			deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+		}
+		bool Expired() const {
+			return enabled && std::chrono::steady_clock::now() >= deadline;
+		}
+		static FPDF_BOOL NeedToPause(IFSDK_PAUSE* pThis) {
+			// pdfium asks between the steps of a progressive render, which shows the render is moving on.
+			NoteProgress();
+			return static_cast<RenderDeadline*>(pThis)->Expired();
+		}
+	};
+
+	// Create the bitmap a page or band is rendered into. Grayscale profiles render
+	// straight into a single channel bitmap.
+	FPDF_BITMAP CreateRenderBitmap(
+		int width, int height, int alpha, const RenderProfileSettings& settings) {
+		if (settings.grayscaleBitmap) {
+			return FPDFBitmap_CreateEx(width, height, FPDFBitmap_Gray, nullptr, 0);
+		}
+		return FPDFBitmap_Create(width, height, alpha);
+	}
+
+	// Render the page in horizontal bands of at most tileHeight rows, passing each band
+	// to the sink as it is finished. Only a single band bitmap is allocated at a time.
+	// The deadline is checked between bands, once it passes the remaining bands are
+	// passed on blank and the render is reported as partial.
+	bool RenderPageTiles(
+		FPDF_FORMHANDLE& form, FPDF_PAGE page, const PageDimensions& renderDims,
+		int tileHeight, const RenderProfileSettings& settings, RenderDeadline& deadline,
+		RenderSink& sink, RenderStatus& status) {
+		status = RenderStatus::FAILED;
+		int width = renderDims.width;
+		int height = renderDims.height;
+		if (!CheckDimensions(0, width, height) || width == 0 || height == 0) return false;
+		int bandheight = std::min(tileHeight, height);
+		int alpha = FPDFPage_HasTransparency(page) && !settings.grayscaleBitmap ? 1 : 0;
+		ScopedFPDFBitmap bitmap(CreateRenderBitmap(width, bandheight, alpha, settings));
+		if (!bitmap) {
+			std::string errMsg = "Render tile was too large to be allocated.";
+			fprintf(stderr, "%s\n", errMsg.c_str());
+			return false;
+		}
+		if (!sink.Begin(width, height)) return false;
+
+		bool expired = false;
+		float scale = static_cast<float>(height) / GetPageSize().GetPageDimensions().height;
+		FPDF_DWORD fill_color = alpha ? 0x00000000 : 0xFFFFFFFF;
+		int stride = FPDFBitmap_GetStride(bitmap.get());
+		RecordBitmapBytes(static_cast<size_t>(stride) * bandheight);
+		for (int bandtop = 0; bandtop < height; bandtop += bandheight) {
+			int rows = std::min(bandheight, height - bandtop);
+			FPDFBitmap_FillRect(bitmap.get(), 0, 0, width, bandheight, 0xFFFFFFFF);
+			NoteProgress();
+			expired = expired || deadline.Expired();
+			if (!expired) {
+				// Scale the page to the render size, then shift it up so the band
+				// starting at bandtop lands at the top of the bitmap.
+				FS_MATRIX matrix = { scale, 0, 0, scale, 0, static_cast<float>(-bandtop) };
+				FS_RECTF clip = { 0, 0, static_cast<float>(width), static_cast<float>(rows) };
+				FPDFBitmap_FillRect(bitmap.get(), 0, 0, width, bandheight, fill_color);
+				FPDF_RenderPageBitmapWithMatrix(bitmap.get(), page, &matrix, &clip, settings.flags);
+				if (settings.drawForms) {
+					FPDF_FFLDraw(form, bitmap.get(), page, 0, -bandtop, width, height, 0, settings.flags);
+				}
+			}
+
+			cv::Mat band;
+			if (settings.grayscaleBitmap) {
+				cv::Mat gray(bandheight, width, CV_8UC1, FPDFBitmap_GetBuffer(bitmap.get()), stride);
+				band = gray.rowRange(0, rows);
+			}
+			else {
+				cv::Mat bgra(bandheight, width, CV_8UC4, FPDFBitmap_GetBuffer(bitmap.get()), stride);
+				cv::cvtColor(bgra.rowRange(0, rows), band, cv::COLOR_BGRA2GRAY);
+			}
+			if (!sink.WriteBand(band)) return false;
+		}
+		if (!sink.End()) return false;
+		status = expired ? RenderStatus::PARTIAL : RenderStatus::COMPLETE;
+		return true;
+	}
+
+	// Render the page with the progressive rendering API so that the render can be
+	// abandoned once the deadline passes. Whatever was drawn before the deadline is
+	// kept, and status reports whether the render is complete or partial.
+	cv::Mat GetPageRender(
+		FPDF_FORMHANDLE& form, FPDF_PAGE page, int dpi, const RenderProfileSettings& settings,
+		RenderDeadline& deadline, RenderStatus& status) {
 		cv::Mat renderedpage;
+		status = RenderStatus::FAILED;
 		PageDimensions renderedpagedims = CalculateDimensions(dpi);
 		int width = renderedpagedims.width;
 		int height = renderedpagedims.height;
-		int alpha = FPDFPage_HasTransparency(page) ? 1 : 0;
-		FPDF_BITMAP bitmap = FPDFBitmap_Create(width, height, alpha);
+		int alpha = FPDFPage_HasTransparency(page) && !settings.grayscaleBitmap ? 1 : 0;
+		FPDF_BITMAP bitmap = CreateRenderBitmap(width, height, alpha, settings);
 		if (bitmap) {
+			RecordBitmapBytes(static_cast<size_t>(FPDFBitmap_GetStride(bitmap)) * height);
 			FPDF_DWORD fill_color = alpha ? 0x00000000 : 0xFFFFFFFF;
 			FPDFBitmap_FillRect(bitmap, 0, 0, width, height, fill_color);
-			FPDF_RenderPageBitmap(bitmap, page, 0, 0, width, height, 0, FPDF_ANNOT);
-			FPDF_FFLDraw(form, bitmap, page, 0, 0, width, height, 0, FPDF_ANNOT);
-			int stride = FPDFBitmap_GetStride(bitmap);
-			const char* buffer =
-				reinterpret_cast<const char*>(FPDFBitmap_GetBuffer(bitmap));
-			renderedpage = RenderPage(buffer, stride, width, height);
+			int progress = FPDF_RenderPageBitmap_Start(
+				bitmap, page, 0, 0, width, height, 0, settings.flags, &deadline);
+			while (progress == FPDF_RENDER_TOBECONTINUED && !deadline.Expired()) {
+				progress = FPDF_RenderPage_Continue(page, &deadline);
+			}
+			FPDF_RenderPage_Close(page);
+			if (progress == FPDF_RENDER_DONE) {
+				if (settings.drawForms) {
+					FPDF_FFLDraw(form, bitmap, page, 0, 0, width, height, 0, settings.flags);
+				}
+				status = RenderStatus::COMPLETE;
+			}
+			else if (progress == FPDF_RENDER_TOBECONTINUED) {
+				status = RenderStatus::PARTIAL;
+			}
+			if (status != RenderStatus::FAILED) {
+				int stride = FPDFBitmap_GetStride(bitmap);
+				if (settings.grayscaleBitmap) {
+					// Already single channel, so no PNG round trip is needed.
+					renderedpage = cv::Mat(
+						height, width, CV_8UC1, FPDFBitmap_GetBuffer(bitmap), stride).clone();
+				}
+				else {
+					const char* buffer =
+						reinterpret_cast<const char*>(FPDFBitmap_GetBuffer(bitmap));
+					renderedpage = RenderPage(buffer, stride, width, height);
+					if (renderedpage.empty()) status = RenderStatus::FAILED;
+				}
+			}
 			FPDFBitmap_Destroy(bitmap);
 		}
 		else {
-			std::string errMsg = "Page was too large to be rendered.";
+			std::string errMsg = "Page was too large to be rendered as a single bitmap, rendering in tiles.";
 			fprintf(stderr, "%s\n", errMsg.c_str());
+			MatRenderSink sink;
+			if (RenderPageTiles(
+				form, page, renderedpagedims, FALLBACK_TILE_HEIGHT, settings, deadline, sink, status)) {
+				renderedpage = sink.GetRender();
+			}
 		}
 		return renderedpage;
 	}
 
+	// Render the page according to the render options, either streaming it to a file or
+	// storing it in the page information. When the render deadline passes, the timeout
+	// action decides whether the partial render is kept, a low resolution render is
+	// attempted, or the render is dropped.
+	void DetermineRender(
+		FPDF_FORMHANDLE& form, FPDF_PAGE page, const int page_index, const RenderOptions& options) {
+		ScopedStageTimer timer(Stage::RENDER);
+		int dpi = ChooseRenderDpi(GetPageSize(), options);
+		PageDimensions renderdims = CalculateDimensions(dpi);
+		RenderDeadline deadline(options.renderTimeoutMs);
+		RenderProfileSettings settings = GetRenderProfileSettings(options.profile);
+		SetRenderDpi(dpi);
+		RenderStatus status = RenderStatus::FAILED;
+		if (!options.renderDirectory.empty()) {
+			// Streamed bands cannot be taken back, so a streamed render that runs out of
+			// time is always finished as a partial render.
+			std::filesystem::path renderpath = options.renderDirectory /
+				(options.renderFilePrefix + "pg" + std::to_string(page_index + 1) + ".png");
+			PngFileRenderSink sink(renderpath);
+			int tileheight = options.tileHeight > 0 ? options.tileHeight : renderdims.height;
+			if (!RenderPageTiles(
+				form, page, renderdims, tileheight, settings, deadline, sink, status)) {
+				std::string errMsg = "Failed to stream render to " + renderpath.string() + ".";
+				fprintf(stderr, "%s\n", errMsg.c_str());
+			}
+			SetRenderDimensions(renderdims);
+			SetRenderStatus(status);
+			return;
+		}
+
+		cv::Mat render;
+		if (options.tileHeight > 0 && renderdims.height > options.tileHeight) {
+			MatRenderSink sink;
+			if (RenderPageTiles(
+				form, page, renderdims, options.tileHeight, settings, deadline, sink, status)) {
+				render = sink.GetRender();
+			}
+		}
+		else {
+			render = GetPageRender(form, page, dpi, settings, deadline, status);
+		}
+
+		if (status == RenderStatus::PARTIAL) {
+			std::string errMsg = "Render of page " + std::to_string(page_index + 1) +
+				" exceeded " + std::to_string(options.renderTimeoutMs) + "ms.";
+			fprintf(stderr, "%s\n", errMsg.c_str());
+			if (options.timeoutAction == RenderTimeoutAction::LOW_DPI) {
+				deadline.Restart(options.renderTimeoutMs);
+				render = GetPageRender(form, page, options.timeoutDpi, settings, deadline, status);
+				status = status == RenderStatus::COMPLETE ? RenderStatus::LOW_DPI : RenderStatus::SKIPPED;
+				if (status == RenderStatus::LOW_DPI) SetRenderDpi(options.timeoutDpi);
+			}
+			else if (options.timeoutAction == RenderTimeoutAction::SKIP) {
+				status = RenderStatus::SKIPPED;
+			}
+		}
+
+		if (status == RenderStatus::SKIPPED || status == RenderStatus::FAILED) {
+			// Keep the dimensions of the requested render so that word bounds
+			// remain in render coordinates.
+			SetRender(cv::Mat());
+			SetRenderDimensions(renderdims);
+		}
+		else {
+			SetRender(render);
+		}
+		SetRenderStatus(status);
+	}
+
+	cv::Mat RenderLoadedPage(FPDF_PAGE page, int dpi, RenderProfile profile, RenderStatus& status) {
+		SetPageSize(FPDF_GetPageWidth(page), FPDF_GetPageHeight(page));
+		FPDF_FORMHANDLE form = nullptr;
+		RenderDeadline deadline(0);
+		return GetPageRender(form, page, dpi, GetRenderProfileSettings(profile), deadline, status);
+	}
+
+	// Write the embedded image of a page that is a single image, in place of rendering it.
+	bool DeterminePassthroughImage(
+		FPDF_DOCUMENT doc, FPDF_PAGE page, const int page_index, const RenderOptions& options) {
+		ScopedStageTimer timer(Stage::RENDER);
+		PassthroughImage image;
+		std::filesystem::path basepath = options.imageDirectory /
+			(options.renderFilePrefix + "pg" + std::to_string(page_index + 1));
+		if (!WritePassthroughImage(doc, page, basepath, image)) return false;
+		SetPassthroughImage(image);
+		SetRenderDimensions(PageDimensions(image.width, image.height));
+		SetRenderDpi(static_cast<int>(image.dpi + 0.5f));
+		SetRenderStatus(RenderStatus::PASSTHROUGH);
+		return true;
+	}
+
 	// Using the form data to retrieve data specific for a page.
 	FPDF_PAGE
 		GetPageForIndex(FPDF_FORMFILLINFO* param, FPDF_DOCUMENT doc, int index) {
@@ -180,10 +421,39 @@ namespace textextract {
 		return page;
 	}
 
+	// Record a render that did not complete as a degraded page.
+	void CheckRenderStatus(const RenderOptions& options, PageResult& result) {
+		switch (GetRenderStatus()) {
+		case RenderStatus::PARTIAL:
+			result.Degrade("render", "exceeded " + std::to_string(options.renderTimeoutMs) +
+				"ms, only part of the page was rendered");
+			break;
+		case RenderStatus::LOW_DPI:
+			result.Degrade("render", "exceeded " + std::to_string(options.renderTimeoutMs) +
+				"ms, rendered again at " + std::to_string(GetRenderDpi()) + " dpi");
+			break;
+		case RenderStatus::SKIPPED:
+			result.Degrade("render", "exceeded " + std::to_string(options.renderTimeoutMs) +
+				"ms, render was dropped");
+			break;
+		case RenderStatus::FAILED:
+			result.Degrade("render", "page could not be rendered");
+			break;
+		default:
+			break;
+		}
+	}
+
 	void DeterminePageInfo(
 		FPDF_DOCUMENT doc, FPDF_FORMHANDLE& form,
-		FPDF_FORMFILLINFO_PDFiumTest& form_fill_info, const int page_index, int dpi) {
-		FPDF_PAGE page = GetPageForIndex(&form_fill_info, doc, page_index);
+		FPDF_FORMFILLINFO_PDFiumTest& form_fill_info, const int page_index,
+		const RenderOptions& options, PageResult& result) {
+		// Without a form fill environment the page is loaded directly, skipping the
+		// page open and close actions.
+		ScopedStageTimer pageloadtimer(Stage::PAGE_LOAD);
+		FPDF_PAGE page = form ?
+			GetPageForIndex(&form_fill_info, doc, page_index) : FPDF_LoadPage(doc, page_index);
+		pageloadtimer.Stop();
 		if (page) {
 			int pagerotation = FPDFPage_GetRotation(page);
 			SetPageRotation(PageRotation(FPDFPage_GetRotation(page)));
@@ -191,18 +461,212 @@ namespace textextract {
 				PageOrientation::LANDSCAPE : PageOrientation::PORTRAIT);
 			SetPageSize(
 				FPDF_GetPageWidth(page), FPDF_GetPageHeight(page));
+			ScopedStageTimer textpagetimer(Stage::TEXT_PAGE_LOAD);
 			FPDF_TEXTPAGE text_page = FPDFText_LoadPage(page);
-			SetRender(GetPageRender(form, page, dpi));
-			SetRawPageText(GetTextRaw(page));
-			SetPageWords(GetTextWithBounds(page));
+			textpagetimer.Stop();
+			if (!text_page) result.Degrade("text_page_load", "text layer could not be loaded");
+			ScopedStageTimer classifytimer(Stage::CLASSIFY);
+			int charcount = text_page ? FPDFText_CountChars(text_page) : 0;
+			PageClass pageclass = ClassifyPage(page, charcount);
+			SetPageClass(pageclass);
+			classifytimer.Stop();
+			if (options.skipTextOnlyRender && pageclass == PageClass::TEXT_ONLY) {
+				// Keep the dimensions the render would have had, so that word bounds are
+				// still given in render coordinates.
+				int dpi = ChooseRenderDpi(GetPageSize(), options);
+				SetRenderDpi(dpi);
+				SetRenderDimensions(CalculateDimensions(dpi));
+				SetRenderStatus(RenderStatus::NOT_RENDERED);
+			}
+			else if (options.imagePassthrough && pageclass == PageClass::IMAGE_ONLY &&
+				DeterminePassthroughImage(doc, page, page_index, options)) {
+				// The encoded image stands in for the render.
+			}
+			else {
+				DetermineRender(form, page, page_index, options);
+				CheckRenderStatus(options, result);
+			}
+			// Pages without a text layer skip the text stages, as they have no words to find.
+			if (charcount > 0 && options.regions.empty()) {
+				SetRawPageText(GetTextRaw(text_page));
+				SetPageWords(GetTextWithBounds(text_page, {}));
+			}
+			else if (charcount > 0) {
+				// Regions given in pixels are converted with the dpi the page was rendered at.
+				std::vector<FS_RECTF> regions;
+				if (!GetPageRegions(options.regions, page_index + 1, FPDF_GetPageWidthF(page),
+					FPDF_GetPageHeightF(page), PageRotation(pagerotation), options.regionUnit, GetRenderDpi(),
+					regions)) {
+					result.Degrade("roi", "regions are given in pixels but the page has no render dpi");
+				}
+				else if (!regions.empty()) {
+					SetRawPageText(GetTextInRegions(text_page, regions));
+					SetPageWords(GetTextWithBounds(text_page, regions));
+				}
+			}
 
-			form_fill_info.loaded_pages.erase(page_index);
+			if (form) {
+				form_fill_info.loaded_pages.erase(page_index);
 
-			FORM_DoPageAAction(page, form, FPDFPAGE_AACTION_CLOSE);
-			FORM_OnBeforeClosePage(page, form);
+				FORM_DoPageAAction(page, form, FPDFPAGE_AACTION_CLOSE);
+				FORM_OnBeforeClosePage(page, form);
+			}
 			FPDFText_ClosePage(text_page);
 			FPDF_ClosePage(page);
 		}
+		else {
+			result.Fail("page_load", "page could not be loaded");
+		}
+	}
+
+	// RenderSink that hands each band of the render straight to a page visitor.
+	class VisitorRenderSink : public RenderSink {
+	private:
+		PageVisitor& mVisitor;
+		// Row of the render the next band starts at.
+		int mNextRow = 0;
+
+	public:
+		VisitorRenderSink(PageVisitor& visitor) : mVisitor(visitor) {}
+		bool Begin(int width, int height) override {
+			mNextRow = 0;
+			return true;
+		}
+		bool WriteBand(const cv::Mat& band) override {
+			mVisitor.OnRenderTile(mNextRow, band);
+			mNextRow += band.rows;
+			return true;
+		}
+		bool End() override { return true; }
+	};
+
+	// Stream the raw text of a page in chunks, or the text of each region as a chunk.
+	void StreamRawText(FPDF_TEXTPAGE textpage, int charcount, const std::vector<FS_RECTF>& regions,
+		size_t chunkChars, PageVisitor& visitor) {
+		ScopedStageTimer timer(Stage::RAW_TEXT);
+		if (!regions.empty()) {
+			for (const auto& region : regions) {
+				std::wstring regiontext = GetTextInRegions(textpage, { region });
+				if (!regiontext.empty()) visitor.OnRawTextChunk(regiontext);
+			}
+			return;
+		}
+		int chunk = static_cast<int>(std::max<size_t>(chunkChars, 1));
+		std::vector<unsigned short> buffer(chunk + 1);
+		for (int start = 0, count = 0; start < charcount; start += count) {
+			count = std::min(chunk, charcount - start);
+			// Keep a surrogate pair in one chunk, so that each chunk converts on its own.
+			unsigned int last = FPDFText_GetUnicode(textpage, start + count - 1);
+			if (count > 1 && start + count < charcount && last >= 0xD800 && last <= 0xDBFF) count--;
+			// FPDFText_GetText writes a terminating zero after the characters.
+			if (FPDFText_GetText(textpage, start, count, buffer.data()) <= 0) continue;
+			visitor.OnRawTextChunk(GetPlatformWString(buffer.data()));
+		}
+	}
+
+	// Stream the words of a page to the visitor, with a line after the last word of each line.
+	void StreamWords(FPDF_TEXTPAGE textpage, const std::vector<FS_RECTF>& regions,
+		const PageDimensions& renderDims, PageVisitor& visitor) {
+		ScopedStageTimer timer(Stage::BOX_MATCH);
+		int pagewidth = GetPageSize().GetPageDimensions().width;
+		int pageheight = GetPageSize().GetPageDimensions().height;
+		if ((pagewidth < pageheight) && GetPageOrientation() == PageOrientation::LANDSCAPE) {
+			std::swap(pagewidth, pageheight);
+		}
+		PageDimensions pagedims = GetPageSize().GetPageDimensions();
+		bool rescale = renderDims.height != pagedims.height && renderDims.width != pagedims.width;
+		std::wstring linetext;
+		cv::Rect linebounds;
+		VisitTextBoxes(textpage, regions, pagewidth, pageheight,
+			[&](const TextBox& word) {
+				TextBox scaled = word;
+				if (rescale) scaled.RescaleDims(pagedims, renderDims);
+				visitor.OnWord(scaled);
+				if (!linetext.empty()) linetext += L' ';
+				linetext += scaled.GetText();
+				linebounds = linebounds.empty() ? scaled.GetBounds() : linebounds | scaled.GetBounds();
+			},
+			[&]() {
+				visitor.OnLine(TextBox(linebounds, linetext));
+				linetext.clear();
+				linebounds = cv::Rect();
+			});
+	}
+
+	// Stream the contents of a page to the visitor, holding no more than a chunk of text,
+	// a line of words or a render band at a time.
+	void StreamPageContents(
+		FPDF_DOCUMENT doc, FPDF_FORMHANDLE& form,
+		FPDF_FORMFILLINFO_PDFiumTest& form_fill_info, const int page_index,
+		const StreamOptions& options, PageVisitor& visitor, PageResult& result) {
+		ScopedStageTimer pageloadtimer(Stage::PAGE_LOAD);
+		FPDF_PAGE page = form ?
+			GetPageForIndex(&form_fill_info, doc, page_index) : FPDF_LoadPage(doc, page_index);
+		pageloadtimer.Stop();
+		if (!page) {
+			result.Fail("page_load", "page could not be loaded");
+			VisitFailedPage(visitor, result);
+			return;
+		}
+		int pagerotation = FPDFPage_GetRotation(page);
+		SetPageRotation(PageRotation(pagerotation));
+		SetPageOrientation(pagerotation == 1 || pagerotation == 3 ?
+			PageOrientation::LANDSCAPE : PageOrientation::PORTRAIT);
+		SetPageSize(FPDF_GetPageWidth(page), FPDF_GetPageHeight(page));
+		ScopedStageTimer textpagetimer(Stage::TEXT_PAGE_LOAD);
+		FPDF_TEXTPAGE text_page = FPDFText_LoadPage(page);
+		textpagetimer.Stop();
+		if (!text_page) result.Degrade("text_page_load", "text layer could not be loaded");
+		int charcount = text_page ? FPDFText_CountChars(text_page) : 0;
+
+		PageStart start;
+		start.pageNumber = page_index + 1;
+		start.width = FPDF_GetPageWidth(page);
+		start.height = FPDF_GetPageHeight(page);
+		start.rotation = PageRotation(pagerotation);
+		start.pageClass = ClassifyPage(page, charcount);
+		start.charCount = charcount;
+		start.renderDpi = ChooseRenderDpi(GetPageSize(), options.render);
+		start.renderDimensions = CalculateDimensions(start.renderDpi);
+		visitor.OnPageBegin(start);
+
+		if (charcount > 0) {
+			std::vector<FS_RECTF> regions;
+			bool regionsvalid = options.render.regions.empty() || GetPageRegions(options.render.regions,
+				page_index + 1, FPDF_GetPageWidthF(page), FPDF_GetPageHeightF(page), start.rotation,
+				options.render.regionUnit, start.renderDpi, regions);
+			if (!regionsvalid) {
+				result.Degrade("roi", "regions are given in pixels but the page has no render dpi");
+			}
+			// Regions that do not apply to this page leave it without text, as in GetPageInfo.
+			else if (options.render.regions.empty() || !regions.empty()) {
+				StreamRawText(text_page, charcount, regions, options.rawTextChunkChars, visitor);
+				StreamWords(text_page, regions, start.renderDimensions, visitor);
+			}
+		}
+
+		if (options.renderTiles) {
+			ScopedStageTimer timer(Stage::RENDER);
+			RenderDeadline deadline(options.render.renderTimeoutMs);
+			RenderStatus status = RenderStatus::FAILED;
+			VisitorRenderSink sink(visitor);
+			int tileheight = options.tileHeight > 0 ? options.tileHeight : FALLBACK_TILE_HEIGHT;
+			RenderPageTiles(form, page, start.renderDimensions, tileheight,
+				GetRenderProfileSettings(options.render.profile), deadline, sink, status);
+			SetRenderDpi(start.renderDpi);
+			SetRenderStatus(status);
+			CheckRenderStatus(options.render, result);
+		}
+
+		if (form) {
+			form_fill_info.loaded_pages.erase(page_index);
+			FORM_DoPageAAction(page, form, FPDFPAGE_AACTION_CLOSE);
+			FORM_OnBeforeClosePage(page, form);
+		}
+		FPDFText_ClosePage(text_page);
+		FPDF_ClosePage(page);
+		ClearPageInfo();
+		visitor.OnPageEnd(result);
 	}
 
 	void PdfRenderer::DeterminePageCount() {
@@ -235,106 +699,183 @@ namespace textextract {
 	}
 
 	PdfRenderer::~PdfRenderer() {
+		CloseDocument();
 		mBufferedLoaded = false;
 		FPDF_DestroyLibrary();
 	}
 
-	void PdfRenderer::GetPageInfo(int pagenumber, int dpi) {
-		if (!mFileBuffer.empty()) {
-			FPDF_FORMFILLINFO_PDFiumTest form_callbacks = {};
-#ifdef PDF_ENABLE_XFA
-			form_callbacks.version = 2;
-#else // PDF_ENABLE_XFA
-			form_callbacks.version = 1;
-#endif // PDF_ENABLE_XFA
-			form_callbacks.FFI_GetPage = GetPageForIndex;
-
-			DocLoader loader(mFileBuffer.data(), mFileBuffer.size());
-			FPDF_FILEACCESS file_access;
-			memset(&file_access, '\0', sizeof(file_access));
-			file_access.m_FileLen = static_cast<unsigned long>(mFileBuffer.size());
-			file_access.m_GetBlock = DocLoader::GetBlock;
-			file_access.m_Param = &loader;
-
-			FX_FILEAVAIL file_avail;
-			memset(&file_avail, '\0', sizeof(file_avail));
-			file_avail.version = 1;
-			file_avail.IsDataAvail = Is_Data_Avail;
+	bool PdfRenderer::GetDocumentMetadata(DocumentMetadata& metadata) {
+		auto start = std::chrono::steady_clock::now();
+		if (mFileBuffer.empty()) return false;
+		ScopedFPDFDocument doc(FPDF_LoadMemDocument(mFileBuffer.data(), mFileBuffer.size(), nullptr));
+		if (!doc) return false;
+		metadata.pageCount = FPDF_GetPageCount(doc.get());
+		metadata.pages.clear();
+		for (int i = 0; i < metadata.pageCount; i++) {
+			PageMetadata page;
+			page.pageNumber = i + 1;
+			// The size is read from the page dictionary, without parsing the page content.
+			FS_SIZEF size;
+			if (FPDF_GetPageSizeByIndexF(doc.get(), i, &size)) {
+				page.pageSize.DeterminePageSize(static_cast<int>(size.width), static_cast<int>(size.height));
+			}
+			ScopedFPDFPage pdfpage(FPDF_LoadPage(doc.get(), i));
+			if (pdfpage) {
+				page.rotation = PageRotation(FPDFPage_GetRotation(pdfpage.get()));
+				ScopedFPDFTextPage textpage(FPDFText_LoadPage(pdfpage.get()));
+				if (textpage) page.charCount = FPDFText_CountChars(textpage.get());
+			}
+			metadata.pages.push_back(page);
+		}
+		metadata.elapsedMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
 
-			FX_DOWNLOADHINTS hints;
-			memset(&hints, '\0', sizeof(hints));
-			hints.version = 1;
-			hints.AddSegment = Add_Segment;
+	bool PdfRenderer::ExtractPage(int pagenumber, std::string& pdfData) {
+		if (mFileBuffer.empty()) return false;
+		ScopedFPDFDocument source(FPDF_LoadMemDocument(mFileBuffer.data(), mFileBuffer.size(), nullptr));
+		if (!source) return false;
+		ScopedFPDFDocument copy(FPDF_CreateNewDocument());
+		if (!copy) return false;
+		// FPDF_ImportPages takes one based page numbers.
+		std::string pagerange = std::to_string(pagenumber + 1);
+		if (!FPDF_ImportPages(copy.get(), source.get(), pagerange.c_str(), 0)) return false;
+		DocSaver saver;
+		if (!FPDF_SaveAsCopy(copy.get(), &saver, FPDF_NO_INCREMENTAL)) return false;
+		pdfData = saver.GetString();
+		return true;
+	}
 
-			ScopedFPDFAvail pdf_avail(FPDFAvail_Create(&file_avail, &file_access));
+	// An open document, along with the loader, availability and form fill state that
+	// pdfium keeps pointers to for as long as the document is open.
+	struct PdfRenderer::DocumentSession {
+		FPDF_FORMFILLINFO_PDFiumTest formCallbacks = {};
+		std::unique_ptr<DocLoader> loader;
+		FPDF_FILEACCESS fileAccess;
+		FX_FILEAVAIL fileAvail;
+		FX_DOWNLOADHINTS hints;
+		ScopedFPDFAvail avail;
+		ScopedFPDFDocument doc;
+		FPDF_FORMHANDLE form = nullptr;
+		bool linearized = false;
+		// Whether or not the session was opened with the form fill environment.
+		bool usesForms = false;
+
+		~DocumentSession() {
+			if (form) {
+				FORM_DoDocumentAAction(form, FPDFDOC_AACTION_WC);
+				FPDFDOC_ExitFormFillEnvironment(form);
+			}
+		}
+	};
 
-			ScopedFPDFDocument doc;
+	bool PdfRenderer::OpenDocument(bool usesForms, std::string& error) {
+		ScopedStageTimer doctimer(Stage::DOCUMENT_LOAD);
+		CloseDocument();
+		auto session = std::make_unique<DocumentSession>();
+		session->usesForms = usesForms;
+#ifdef PDF_ENABLE_XFA
+		session->formCallbacks.version = 2;
+#else // PDF_ENABLE_XFA
+		session->formCallbacks.version = 1;
+#endif // PDF_ENABLE_XFA
+		session->formCallbacks.FFI_GetPage = GetPageForIndex;
+
+		session->loader = std::make_unique<DocLoader>(mFileBuffer.data(), mFileBuffer.size());
+		FPDF_FILEACCESS& file_access = session->fileAccess;
+		memset(&file_access, '\0', sizeof(file_access));
+		file_access.m_FileLen = static_cast<unsigned long>(mFileBuffer.size());
+		file_access.m_GetBlock = DocLoader::GetBlock;
+		file_access.m_Param = session->loader.get();
+
+		FX_FILEAVAIL& file_avail = session->fileAvail;
+		memset(&file_avail, '\0', sizeof(file_avail));
+		file_avail.version = 1;
+		file_avail.IsDataAvail = Is_Data_Avail;
+
+		FX_DOWNLOADHINTS& hints = session->hints;
+		memset(&hints, '\0', sizeof(hints));
+		hints.version = 1;
+		hints.AddSegment = Add_Segment;
+
+		session->avail.reset(FPDFAvail_Create(&file_avail, &file_access));
+		ScopedFPDFDocument& doc = session->doc;
+
+		int nRet = PDF_DATA_NOTAVAIL;
+		if (FPDFAvail_IsLinearized(session->avail.get()) == PDF_LINEARIZED) {
+			doc.reset(FPDFAvail_GetDocument(session->avail.get(), nullptr));
+			if (doc) {
+				while (nRet == PDF_DATA_NOTAVAIL)
+					nRet = FPDFAvail_IsDocAvail(session->avail.get(), &hints);
 
-			int nRet = PDF_DATA_NOTAVAIL;
-			bool bIsLinearized = false;
-			if (FPDFAvail_IsLinearized(pdf_avail.get()) == PDF_LINEARIZED) {
-				doc.reset(FPDFAvail_GetDocument(pdf_avail.get(), nullptr));
-				if (doc) {
-					while (nRet == PDF_DATA_NOTAVAIL)
-						nRet = FPDFAvail_IsDocAvail(pdf_avail.get(), &hints);
-
-					if (nRet == PDF_DATA_ERROR) {
-						std::string errMsg =
-							"Unknown error in checking if doc was available.";
-						fprintf(stderr, "%s\n", errMsg.c_str());
-						FPDF_CloseDocument(doc.get());
-					}
-					nRet = FPDFAvail_IsFormAvail(pdf_avail.get(), &hints);
+				if (nRet == PDF_DATA_ERROR) {
+					std::string errMsg =
+						"Unknown error in checking if doc was available.";
+					fprintf(stderr, "%s\n", errMsg.c_str());
+					error = errMsg;
+					doc.reset();
+				}
+				else {
+					nRet = FPDFAvail_IsFormAvail(session->avail.get(), &hints);
 					if (nRet == PDF_FORM_ERROR || nRet == PDF_FORM_NOTAVAIL) {
 						std::string errMsg = "Error " + std::to_string(nRet) +
 							" was returned in checking if form was available.";
 						fprintf(stderr, "%s\n", errMsg.c_str());
-						FPDF_CloseDocument(doc.get());
+						error = errMsg;
+						doc.reset();
 					}
-					bIsLinearized = true;
 				}
+				session->linearized = true;
 			}
-			else {
-				doc.reset(FPDF_LoadCustomDocument(&file_access, nullptr));
-			}
+		}
+		else {
+			doc.reset(FPDF_LoadCustomDocument(&file_access, nullptr));
+		}
 
-			if (!doc) {
-				unsigned long err = FPDF_GetLastError();
-				std::string errMsg = "Load pdf docs unsuccessful: ";
-				switch (err) {
-				case FPDF_ERR_SUCCESS: errMsg += "Success"; break;
-				case FPDF_ERR_UNKNOWN: errMsg += "Unknown error"; break;
-				case FPDF_ERR_FILE:
-					errMsg += "File not found or could not be opened";
-					break;
-				case FPDF_ERR_FORMAT:
-					errMsg += "File not in PDF format or corrupted";
-					break;
-				case FPDF_ERR_PASSWORD:
-					errMsg += "Password required or incorrect password";
-					break;
-				case FPDF_ERR_SECURITY:
-					errMsg += "Unsupported security scheme";
-					break;
-				case FPDF_ERR_PAGE:
-					errMsg += "Page not found or content error";
-					break;
-				default: errMsg += "Unknown error " + std::to_string(err);
-				}
-				fprintf(stderr, "%s\n", errMsg.c_str());
+		if (!doc && !error.empty()) return false;
+		if (!doc) {
+			unsigned long err = FPDF_GetLastError();
+			std::string errMsg = "Load pdf docs unsuccessful: ";
+			switch (err) {
+			case FPDF_ERR_SUCCESS: errMsg += "Success"; break;
+			case FPDF_ERR_UNKNOWN: errMsg += "Unknown error"; break;
+			case FPDF_ERR_FILE:
+				errMsg += "File not found or could not be opened";
+				break;
+			case FPDF_ERR_FORMAT:
+				errMsg += "File not in PDF format or corrupted";
+				break;
+			case FPDF_ERR_PASSWORD:
+				errMsg += "Password required or incorrect password";
+				break;
+			case FPDF_ERR_SECURITY:
+				errMsg += "Unsupported security scheme";
+				break;
+			case FPDF_ERR_PAGE:
+				errMsg += "Page not found or content error";
+				break;
+			default: errMsg += "Unknown error " + std::to_string(err);
 			}
+			fprintf(stderr, "%s\n", errMsg.c_str());
+			error = errMsg;
+			return false;
+		}
 
-			(void)FPDF_GetDocPermissions(doc.get());
+		(void)FPDF_GetDocPermissions(doc.get());
 
-			FPDF_FORMHANDLE form =
-				FPDFDOC_InitFormFillEnvironment(doc.get(), &form_callbacks);
-			form_callbacks.form_handle = form;
+		// The form fill environment and document actions only affect the appearance
+		// of form fields, so they are skipped unless form fields are to be rendered.
+		if (usesForms) {
+			FPDF_FORMHANDLE form = FPDFDOC_InitFormFillEnvironment(doc.get(), &session->formCallbacks);
+			session->form = form;
+			session->formCallbacks.form_handle = form;
 
 #ifdef PDF_ENABLE_XFA
 			int doc_type = DOCTYPE_PDF;
 			if (
-				FPDF_HasXFAField(doc, &doc_type) && doc_type != DOCTYPE_PDF &&
-				!FPDF_LoadXFA(doc)) {
+				FPDF_HasXFAField(doc.get(), &doc_type) && doc_type != DOCTYPE_PDF &&
+				!FPDF_LoadXFA(doc.get())) {
 				fprintf(stderr, "LoadXFA unsuccessful, continuing anyway.\n");
 			}
 #endif // PDF_ENABLE_XFA
@@ -343,24 +884,78 @@ namespace textextract {
 
 			FORM_DoDocumentJSAction(form);
 			FORM_DoDocumentOpenAction(form);
+		}
+		mSession = std::move(session);
+		return true;
+	}
 
-			if (bIsLinearized) {
-				nRet = PDF_DATA_NOTAVAIL;
-				while (nRet == PDF_DATA_NOTAVAIL)
-					nRet = FPDFAvail_IsPageAvail(pdf_avail.get(), pagenumber, &hints);
+	void PdfRenderer::CloseDocument() {
+		mSession.reset();
+	}
 
-				if (nRet == PDF_DATA_ERROR) {
-					std::string errMsg = "Unknown error in checking if page " +
-						std::to_string(pagenumber) + " is available.";
-					fprintf(stderr, "%s\n", errMsg.c_str());
-					FPDFDOC_ExitFormFillEnvironment(form);
-					FPDF_CloseDocument(doc.get());
-				}
+	bool PdfRenderer::PrepareDocument(const RenderOptions& options, std::string& error) {
+		if (mFileBuffer.empty()) {
+			error = "no PDF data was loaded";
+			return false;
+		}
+		// The document stays open between pages, and is only opened again when the
+		// options need a different form fill setup.
+		bool usesforms = UsesFormEnvironment(options);
+		if (mSession && mSession->usesForms == usesforms) return true;
+		return OpenDocument(usesforms, error);
+	}
+
+	PageResult PdfRenderer::GetPageInfo(int pagenumber, const RenderOptions& options) {
+		ScopedStageTimer pagetimer(Stage::PAGE_TOTAL);
+		PageResult result;
+		result.pageNumber = pagenumber + 1;
+		std::string error;
+		if (!PrepareDocument(options, error)) {
+			result.Fail("document_load", error);
+			return result;
+		}
+
+		if (mSession->linearized) {
+			int nRet = PDF_DATA_NOTAVAIL;
+			while (nRet == PDF_DATA_NOTAVAIL)
+				nRet = FPDFAvail_IsPageAvail(mSession->avail.get(), pagenumber, &mSession->hints);
+
+			if (nRet == PDF_DATA_ERROR) {
+				std::string errMsg = "Unknown error in checking if page " +
+					std::to_string(pagenumber) + " is available.";
+				fprintf(stderr, "%s\n", errMsg.c_str());
+				result.Fail("page_load", errMsg);
+				return result;
 			}
-			DeterminePageInfo(doc.get(), form, form_callbacks, pagenumber, dpi);
-			FORM_DoDocumentAAction(form, FPDFDOC_AACTION_WC);
+		}
+		DeterminePageInfo(
+			mSession->doc.get(), mSession->form, mSession->formCallbacks, pagenumber, options, result);
+		return result;
+	}
 
-			FPDFDOC_ExitFormFillEnvironment(form);
+	PageResult PdfRenderer::StreamPage(int pagenumber, const StreamOptions& options, PageVisitor& visitor) {
+		ScopedStageTimer pagetimer(Stage::PAGE_TOTAL);
+		PageResult result;
+		result.pageNumber = pagenumber + 1;
+		std::string error;
+		if (!PrepareDocument(options.render, error)) {
+			result.Fail("document_load", error);
+			VisitFailedPage(visitor, result);
+			return result;
+		}
+		if (mSession->linearized) {
+			int nRet = PDF_DATA_NOTAVAIL;
+			while (nRet == PDF_DATA_NOTAVAIL)
+				nRet = FPDFAvail_IsPageAvail(mSession->avail.get(), pagenumber, &mSession->hints);
+			if (nRet == PDF_DATA_ERROR) {
+				result.Fail("page_load", "unknown error in checking if page " +
+					std::to_string(pagenumber) + " is available");
+				VisitFailedPage(visitor, result);
+				return result;
+			}
 		}
+		StreamPageContents(
+			mSession->doc.get(), mSession->form, mSession->formCallbacks, pagenumber, options, visitor, result);
+		return result;
 	}
 } // namespace textextract
\ No newline at end of file
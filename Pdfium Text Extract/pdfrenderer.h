@@ -2,6 +2,7 @@
 #define PDF_RENDER
 
 #include <map>
+#include <memory>
 
 #if defined PDF_ENABLE_SKIA && !defined _SKIA_SUPPORT_
 #define _SKIA_SUPPORT_
@@ -11,11 +12,17 @@
 #include "pdfium/fpdf_edit.h"
 #include "pdfium/fpdf_ext.h"
 #include "pdfium/fpdf_formfill.h"
+#include "pdfium/fpdf_ppo.h"
+#include "pdfium/fpdf_progressive.h"
 #include "pdfium/fpdf_text.h"
 #include "pdfium/fpdfview.h"
+#include "docmetadata.h"
 #include "image_diff_png.h"
 #include "load_support.h"
+#include "pageresult.h"
+#include "pagevisitor.h"
 #include "pdfpageinfo.h"
+#include "renderoptions.h"
 
 #ifdef _WIN32
 #include <io.h>
@@ -50,6 +57,19 @@ namespace textextract {
 		FPDF_FORMHANDLE form_handle;
 	};
 
+	/**
+	* Render a page that is already loaded, the same way PdfRenderer renders pages, but
+	* without a form fill environment or a time limit. Sets the page size in PageInfo.
+	*
+	* @param page The page to render.
+	* @param dpi Resolution of the render in dots per inch.
+	* @param profile Render profile deciding the render flags and bitmap format.
+	* @param status Set to the result of the render.
+	*
+	* @returns The render of the page, empty if the render failed.
+	*/
+	cv::Mat RenderLoadedPage(FPDF_PAGE page, int dpi, RenderProfile profile, RenderStatus& status);
+
 	class PdfRenderer {
 	private:
 		// Number of pages of the PDF.
@@ -60,6 +80,9 @@ namespace textextract {
 		std::string mFilePath;
 		// Buffer that holds the PDF file data.
 		std::vector<char> mFileBuffer;
+		// The open document that pages are processed from.
+		struct DocumentSession;
+		std::unique_ptr<DocumentSession> mSession;
 		/**
 		* Initialize the PDF rendering engine.
 		*
@@ -70,6 +93,17 @@ namespace textextract {
 		* Assuming the PDF is successfully initialized, determine its page count.
 		*/
 		void DeterminePageCount();
+		/**
+		* Open the document for processing pages, closing any document already open.
+		*
+		* @param usesForms Whether or not to set up the form fill environment and run
+		* the document actions.
+		*
+		* @param error Set to the reason the document could not be opened.
+		*
+		* @returns True if the document was opened.
+		*/
+		bool OpenDocument(bool usesForms, std::string& error);
 
 	public:
 		PdfRenderer(std::string pdfpath);
@@ -77,11 +111,60 @@ namespace textextract {
 		/**
 		* Get the information about a page, such as text, default dimensions, rotation, and render.
 		* Sets the information in PageInfo for accessibilty outside of PdfRenderer class.
+		* The document is opened by the first call and stays open for the pages after it.
 		* 
 		* @param pageNumber Page number from PDF to derive information from.
-		* @param dpi Dots Per Inch metric used for rendering page to a desired resolution.
+		* @param options Settings for rendering the page, such as resolution and tiling.
+		*
+		* @returns Whether the page was processed cleanly, degraded or failed, and why.
+		*/
+		PageResult GetPageInfo(int pageNumber, const RenderOptions& options);
+		/**
+		* Stream the contents of a page to a visitor as they are produced, without setting
+		* the words, raw text or render in PageInfo. The document is opened by the first
+		* call and stays open for the pages after it, as with GetPageInfo.
+		*
+		* @param pageNumber Page number from PDF to stream.
+		* @param options Which parts of the page are streamed, and how it is rendered.
+		* @param visitor Receives the contents of the page.
+		*
+		* @returns Whether the page was processed cleanly, degraded or failed, and why.
+		*/
+		PageResult StreamPage(int pageNumber, const StreamOptions& options, PageVisitor& visitor);
+		/**
+		* Open the document for processing pages with the given options, unless it is already
+		* open with a matching form fill setup. GetPageInfo does this itself, calling it first
+		* lets the document be parsed before processes are forked to share it.
+		*
+		* @param options Settings the pages will be processed with.
+		* @param error Set to the reason the document could not be opened.
+		*
+		* @returns True if the document is open.
+		*/
+		bool PrepareDocument(const RenderOptions& options, std::string& error);
+		/**
+		* Close the document opened for processing pages, running its close actions.
+		*/
+		void CloseDocument();
+		/**
+		* Gather the size, rotation and text character count of every page, without
+		* setting up forms, rendering or extracting words.
+		*
+		* @param metadata Set to the metadata of the document.
+		*
+		* @returns True if the document was loaded.
+		*/
+		bool GetDocumentMetadata(DocumentMetadata& metadata);
+		/**
+		* Copy a single page into a new standalone PDF, so that the page can be shared
+		* without the rest of the document.
+		*
+		* @param pageNumber Page number from PDF to copy.
+		* @param pdfData Set to the bytes of the new PDF.
+		*
+		* @returns True if the page was copied and saved.
 		*/
-		void GetPageInfo(int pageNumber, int dpi);
+		bool ExtractPage(int pageNumber, std::string& pdfData);
 		/**
 		* Get the pagecount for the current PDF.
 		*
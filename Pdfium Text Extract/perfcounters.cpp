@@ -0,0 +1,185 @@
+#include "perfcounters.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace textextract {
+	PerfCounts& PerfCounts::operator+=(const PerfCounts& other) {
+		cycles += other.cycles;
+		instructions += other.instructions;
+		cacheMisses += other.cacheMisses;
+		branchMisses += other.branchMisses;
+		return *this;
+	}
+
+	PerfCounts PerfCounts::operator-(const PerfCounts& other) const {
+		PerfCounts diff;
+		diff.cycles = cycles - other.cycles;
+		diff.instructions = instructions - other.instructions;
+		diff.cacheMisses = cacheMisses - other.cacheMisses;
+		diff.branchMisses = branchMisses - other.branchMisses;
+		return diff;
+	}
+
+	namespace {
+		bool mEnabled = false;
+	} // namespace
+
+#ifdef __linux__
+	namespace {
+		const int COUNTER_COUNT = 4;
+		const uint64_t COUNTER_CONFIGS[COUNTER_COUNT] = {
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES
+		};
+
+		// Counters opened by every thread. A counter opened for a thread keeps counting
+		// that thread in a forked child, so the child closes them all.
+		std::mutex mCounterFdsMutex;
+		std::vector<int> mCounterFds;
+		std::once_flag mForkHandlerOnce;
+
+		// Counter group opened for a single thread. The cycle counter leads the group so
+		// that all counters are scheduled together and read with a single call.
+		struct ThreadCounters {
+			bool opened = false;
+			int leader = -1;
+			int fds[COUNTER_COUNT] = { -1, -1, -1, -1 };
+			// Order in which the opened counters appear in a group read.
+			int slots[COUNTER_COUNT] = { -1, -1, -1, -1 };
+			int opencount = 0;
+
+			~ThreadCounters() {
+				std::lock_guard<std::mutex> lock(mCounterFdsMutex);
+				for (int fd : fds) {
+					if (fd < 0) continue;
+					close(fd);
+					mCounterFds.erase(std::remove(mCounterFds.begin(), mCounterFds.end(), fd), mCounterFds.end());
+				}
+			}
+		};
+
+		thread_local ThreadCounters mThreadCounters;
+
+		void LockCounterFds() {
+			mCounterFdsMutex.lock();
+		}
+
+		void UnlockCounterFds() {
+			mCounterFdsMutex.unlock();
+		}
+
+		// Close the inherited counters in a forked child, so that the forking thread opens
+		// counters of its own on its next read.
+		void CloseCounterFdsInChild() {
+			for (int fd : mCounterFds) close(fd);
+			mCounterFds.clear();
+			mCounterFdsMutex.unlock();
+			mThreadCounters = ThreadCounters();
+		}
+
+		int OpenCounter(uint64_t config, int groupFd) {
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = config;
+			attr.disabled = groupFd == -1 ? 1 : 0;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP;
+			return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+		}
+
+		// Open the counter group for the calling thread, returns false if the cycle
+		// counter leading the group cannot be opened.
+		bool OpenThreadCounters(ThreadCounters& counters) {
+			std::call_once(mForkHandlerOnce, []() {
+				pthread_atfork(LockCounterFds, UnlockCounterFds, CloseCounterFdsInChild);
+			});
+			std::lock_guard<std::mutex> lock(mCounterFdsMutex);
+			counters.opened = true;
+			for (int i = 0; i < COUNTER_COUNT; i++) {
+				int fd = OpenCounter(COUNTER_CONFIGS[i], counters.leader);
+				if (fd < 0) {
+					if (i == 0) return false;
+					// Not every CPU supports every event, the rest are still read.
+					continue;
+				}
+				if (i == 0) counters.leader = fd;
+				counters.fds[i] = fd;
+				mCounterFds.push_back(fd);
+				counters.slots[i] = counters.opencount++;
+			}
+			ioctl(counters.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(counters.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			return true;
+		}
+
+		ThreadCounters& GetThreadCounters() {
+			if (!mThreadCounters.opened) OpenThreadCounters(mThreadCounters);
+			return mThreadCounters;
+		}
+	} // namespace
+
+	bool EnablePerfCounters() {
+		ThreadCounters& counters = GetThreadCounters();
+		if (counters.leader < 0) {
+			std::cerr << "Hardware performance counters are unavailable: " << strerror(errno)
+				<< ". Check /proc/sys/kernel/perf_event_paranoid or container permissions." << std::endl;
+			mEnabled = false;
+			return false;
+		}
+		mEnabled = true;
+		return true;
+	}
+
+	bool ReadPerfCounters(PerfCounts& counts) {
+		counts = PerfCounts();
+		ThreadCounters& counters = GetThreadCounters();
+		if (counters.leader < 0) return false;
+		// Group reads return the number of counters followed by each value.
+		uint64_t values[1 + COUNTER_COUNT] = {};
+		if (read(counters.leader, values, sizeof(values)) < static_cast<ssize_t>(sizeof(uint64_t))) {
+			return false;
+		}
+		uint64_t* fields[COUNTER_COUNT] = {
+			&counts.cycles, &counts.instructions, &counts.cacheMisses, &counts.branchMisses };
+		for (int i = 0; i < COUNTER_COUNT; i++) {
+			if (counters.slots[i] >= 0 && static_cast<uint64_t>(counters.slots[i]) < values[0]) {
+				*fields[i] = values[1 + counters.slots[i]];
+			}
+		}
+		return true;
+	}
+#else
+	bool EnablePerfCounters() {
+		std::cerr << "Hardware performance counters are only supported on Linux." << std::endl;
+		mEnabled = false;
+		return false;
+	}
+
+	bool ReadPerfCounters(PerfCounts& counts) {
+		counts = PerfCounts();
+		return false;
+	}
+#endif // __linux__
+
+	bool PerfCountersEnabled() {
+		return mEnabled;
+	}
+} // namespace textextract
@@ -0,0 +1,46 @@
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS
+
+#include <cstdint>
+
+namespace textextract {
+	/**
+	* @brief Hardware event counts, either running totals or the difference between two
+	* readings.
+	*/
+	struct PerfCounts {
+		uint64_t cycles = 0;
+		uint64_t instructions = 0;
+		uint64_t cacheMisses = 0;
+		uint64_t branchMisses = 0;
+
+		PerfCounts& operator+=(const PerfCounts& other);
+		PerfCounts operator-(const PerfCounts& other) const;
+	};
+
+	/**
+	* Try to turn on hardware performance counters. They are read through perf_event_open,
+	* so are only available on Linux, and may be blocked in containers or by
+	* perf_event_paranoid. When they cannot be opened a reason is printed and counting
+	* stays off.
+	*
+	* @returns True if counters are available.
+	*/
+	bool EnablePerfCounters();
+	/**
+	* Determine if hardware performance counters are being read.
+	*
+	* @returns True if counters were successfully enabled.
+	*/
+	bool PerfCountersEnabled();
+	/**
+	* Read the counters for the calling thread, opening them for the thread if needed.
+	* Counters the hardware does not support read as zero.
+	*
+	* @param counts Set to the current counter values.
+	*
+	* @returns True if the counters could be read.
+	*/
+	bool ReadPerfCounters(PerfCounts& counts);
+} // namespace textextract
+#endif
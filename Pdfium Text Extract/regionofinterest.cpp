@@ -0,0 +1,89 @@
+#include "regionofinterest.h"
+
+#include "load_support.h"
+
+namespace textextract {
+	bool ParseRegions(const std::string& regionList, std::vector<PageRegion>& regions) {
+		for (const auto& item : StringSplit(regionList, ';')) {
+			if (item.empty()) continue;
+			PageRegion region;
+			std::string rect = item;
+			size_t colon = item.find(':');
+			try {
+				if (colon != std::string::npos) {
+					region.page = std::stoi(item.substr(0, colon));
+					rect = item.substr(colon + 1);
+				}
+				std::vector<std::string> values = StringSplit(rect, ',');
+				if (values.size() != 4) return false;
+				region.x = std::stod(values[0]);
+				region.y = std::stod(values[1]);
+				region.width = std::stod(values[2]);
+				region.height = std::stod(values[3]);
+			}
+			catch (const std::exception&) {
+				return false;
+			}
+			if (region.page < 0 || region.width <= 0 || region.height <= 0) return false;
+			regions.push_back(region);
+		}
+		return !regions.empty();
+	}
+
+	bool ParseRegionUnit(const std::string& name, RegionUnit& unit) {
+		if (name == "points") unit = RegionUnit::POINTS;
+		else if (name == "pixels") unit = RegionUnit::PIXELS;
+		else return false;
+		return true;
+	}
+
+	bool GetPageRegions(const std::vector<PageRegion>& regions, int pageNumber,
+		double pageWidth, double pageHeight, PageRotation rotation, RegionUnit unit, int renderDpi,
+		std::vector<FS_RECTF>& pageRegions) {
+		pageRegions.clear();
+		for (const auto& region : regions) {
+			if (region.page != 0 && region.page != pageNumber) continue;
+			// Without a render there is no pixel size to convert the region from.
+			if (unit == RegionUnit::PIXELS && renderDpi <= 0) {
+				pageRegions.clear();
+				return false;
+			}
+			double scale = unit == RegionUnit::PIXELS ? 72.0 / renderDpi : 1.0;
+			double left = region.x * scale;
+			double right = (region.x + region.width) * scale;
+			double top = region.y * scale;
+			double bottom = (region.y + region.height) * scale;
+			FS_RECTF rect;
+			switch (rotation) {
+			case PageRotation::CLOCKWISE_90:
+				// The left edge of the page is displayed along the top.
+				rect.left = static_cast<float>(top);
+				rect.right = static_cast<float>(bottom);
+				rect.bottom = static_cast<float>(left);
+				rect.top = static_cast<float>(right);
+				break;
+			case PageRotation::CLOCKWISE_180:
+				rect.left = static_cast<float>(pageWidth - right);
+				rect.right = static_cast<float>(pageWidth - left);
+				rect.bottom = static_cast<float>(top);
+				rect.top = static_cast<float>(bottom);
+				break;
+			case PageRotation::CLOCKWISE_270:
+				// The right edge of the page is displayed along the top.
+				rect.left = static_cast<float>(pageHeight - bottom);
+				rect.right = static_cast<float>(pageHeight - top);
+				rect.bottom = static_cast<float>(pageWidth - right);
+				rect.top = static_cast<float>(pageWidth - left);
+				break;
+			default:
+				rect.left = static_cast<float>(left);
+				rect.right = static_cast<float>(right);
+				rect.top = static_cast<float>(pageHeight - top);
+				rect.bottom = static_cast<float>(pageHeight - bottom);
+				break;
+			}
+			pageRegions.push_back(rect);
+		}
+		return true;
+	}
+} // namespace textextract
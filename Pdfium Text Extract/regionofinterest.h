@@ -0,0 +1,75 @@
+#ifndef REGION_OF_INTEREST
+#define REGION_OF_INTEREST
+
+#include <string>
+#include <vector>
+
+#include "pdfium/fpdfview.h"
+#include "viewutils.h"
+
+namespace textextract {
+	// Units the rectangles of a region of interest are given in.
+	enum class RegionUnit {
+		// Points (1/72 inch) on the page.
+		POINTS = 0,
+		// Pixels of the page render, at the dpi the page is rendered at.
+		PIXELS = 1
+	};
+
+	/**
+	* @brief A rectangle of a page to extract text from, measured from the top left corner.
+	*/
+	struct PageRegion {
+		// One based page number the region applies to, 0 for every page.
+		int page = 0;
+		// Left edge of the region.
+		double x = 0.0;
+		// Top edge of the region, measured down from the top of the page.
+		double y = 0.0;
+		// Width of the region.
+		double width = 0.0;
+		// Height of the region.
+		double height = 0.0;
+	};
+
+	/**
+	* Parse regions of interest written as rectangles separated by semicolons. Each
+	* rectangle is x,y,width,height, optionally prefixed by a page number and a colon to
+	* apply to a single page, such as "2:50,60,200,40;0,0,300,100".
+	*
+	* @param regionList The regions to parse.
+	* @param regions Set to the parsed regions.
+	*
+	* @returns True if every region was valid.
+	*/
+	bool ParseRegions(const std::string& regionList, std::vector<PageRegion>& regions);
+	/**
+	* Parse the name of a region unit.
+	*
+	* @param name One of "points" or "pixels".
+	* @param unit Set to the parsed unit if the name is valid.
+	*
+	* @returns True if the name was a valid region unit.
+	*/
+	bool ParseRegionUnit(const std::string& name, RegionUnit& unit);
+	/**
+	* Get the regions that apply to a page, as rectangles in PDF page coordinates, with
+	* the origin at the bottom left of the page. Regions are measured on the page as it is
+	* displayed, so on rotated pages they are turned back into the unrotated coordinates
+	* that character boxes are given in.
+	*
+	* @param regions Every region of interest.
+	* @param pageNumber One based number of the page.
+	* @param pageWidth Width of the page as displayed, in points.
+	* @param pageHeight Height of the page as displayed, in points.
+	* @param rotation Clockwise rotation the page is displayed with.
+	* @param unit Units the regions are given in.
+	* @param renderDpi Resolution the page is rendered at, for regions given in pixels.
+	* @param pageRegions Set to the rectangles of the page's regions.
+	*
+	* @returns False if the page has regions given in pixels but no render dpi to convert them with.
+	*/
+	bool GetPageRegions(const std::vector<PageRegion>& regions, int pageNumber,
+		double pageWidth, double pageHeight, PageRotation rotation, RegionUnit unit, int renderDpi, std::vector<FS_RECTF>& pageRegions);
+} // namespace textextract
+#endif
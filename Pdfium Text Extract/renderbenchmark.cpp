@@ -0,0 +1,90 @@
+#include "renderbenchmark.h"
+
+#include "stagetimer.h"
+
+#include <opencv2/core.hpp>
+
+#include <iomanip>
+
+namespace textextract {
+	namespace {
+		// Stages a render profile changes the cost of: the page load, where forms are set up
+		// and page actions run, and the render itself. The text stages are left out.
+		const Stage PROFILE_STAGES[] = { Stage::PAGE_LOAD, Stage::RENDER, Stage::PNG_ROUND_TRIP };
+	} // namespace
+
+	std::vector<RenderProfileResult> BenchmarkRenderProfiles(
+		PdfRenderer& pdf, const std::vector<int>& pages, RenderOptions options) {
+		const std::pair<RenderProfile, DocumentOpenMode> profiles[] = {
+			{ RenderProfile::FAITHFUL, DocumentOpenMode::FULL },
+			{ RenderProfile::DEBUG, DocumentOpenMode::LEAN },
+			{ RenderProfile::OCR_FAST, DocumentOpenMode::LEAN },
+			{ RenderProfile::OCR_FAST, DocumentOpenMode::FULL } };
+		std::vector<RenderProfileResult> results;
+		for (auto& profile : profiles) {
+			RenderProfileResult result;
+			result.profile = profile.first;
+			result.openMode = profile.second;
+			results.push_back(result);
+		}
+		// Renders have to be kept in memory to be compared.
+		options.renderDirectory.clear();
+		// The page stage timings pick the profile's stages out of each page.
+		bool stagestats = StageStatsEnabled();
+		EnableStageStats(true);
+
+		for (int pagenumber : pages) {
+			int i = pagenumber - 1;
+			cv::Mat reference;
+			for (auto& result : results) {
+				options.profile = result.profile;
+				options.openMode = result.openMode;
+				ResetPageStageTimes();
+				pdf.GetPageInfo(i, options);
+				nlohmann::json stagetimes = GetPageStageTimes();
+				for (Stage stage : PROFILE_STAGES) {
+					result.seconds += stagetimes.value(StageToString(stage), 0.0) / 1000.0;
+				}
+				result.pageCount++;
+
+				cv::Mat render = GetPageRender();
+				if (result.profile == RenderProfile::FAITHFUL) {
+					reference = render;
+				}
+				else if (!render.empty() && render.rows == reference.rows && render.cols == reference.cols) {
+					double pixels = static_cast<double>(render.rows) * render.cols;
+					result.meanPixelDifference += cv::norm(render, reference, cv::NORM_L1) / pixels;
+					result.maxPixelDifference = std::max(
+						result.maxPixelDifference, cv::norm(render, reference, cv::NORM_INF));
+				}
+				ClearPageInfo();
+			}
+		}
+
+		EnableStageStats(stagestats);
+		for (auto& result : results) {
+			if (result.pageCount > 0) result.meanPixelDifference /= result.pageCount;
+		}
+		return results;
+	}
+
+	void PrintRenderProfileResults(const std::vector<RenderProfileResult>& results, std::ostream& out) {
+		out << std::left << std::setw(10) << "profile"
+			<< std::setw(6) << "open"
+			<< std::right << std::setw(12) << "pages/sec"
+			<< std::setw(12) << "ms/page"
+			<< std::setw(12) << "mean diff"
+			<< std::setw(12) << "max diff" << "\n";
+		for (const auto& result : results) {
+			double pagespersecond = result.seconds > 0 ? result.pageCount / result.seconds : 0.0;
+			double mspage = result.pageCount > 0 ? 1000.0 * result.seconds / result.pageCount : 0.0;
+			out << std::left << std::setw(10) << RenderProfileToString(result.profile)
+				<< std::setw(6) << (result.openMode == DocumentOpenMode::LEAN ? "lean" : "full")
+				<< std::right << std::fixed << std::setprecision(2)
+				<< std::setw(12) << pagespersecond
+				<< std::setw(12) << mspage
+				<< std::setw(12) << result.meanPixelDifference
+				<< std::setw(12) << result.maxPixelDifference << "\n";
+		}
+	}
+} // namespace textextract
@@ -0,0 +1,54 @@
+#ifndef RENDER_BENCHMARK
+#define RENDER_BENCHMARK
+
+#include "pdfrenderer.h"
+#include "renderoptions.h"
+
+#include <ostream>
+#include <vector>
+
+namespace textextract {
+	/**
+	* @brief Throughput and pixel difference of a render profile, measured against
+	* the faithful profile over the same pages.
+	*/
+	struct RenderProfileResult {
+		// The profile that was measured.
+		RenderProfile profile = RenderProfile::FAITHFUL;
+		// How the document was opened for the profile.
+		DocumentOpenMode openMode = DocumentOpenMode::AUTO;
+		// Number of pages processed with the profile.
+		int pageCount = 0;
+		// Total time spent loading and rendering pages with the profile, in seconds.
+		double seconds = 0.0;
+		// Mean absolute difference of gray levels from the faithful render, 0 to 255.
+		double meanPixelDifference = 0.0;
+		// Largest difference of a single pixel from the faithful render, 0 to 255.
+		double maxPixelDifference = 0.0;
+	};
+
+	/**
+	* Process each page in the range once with every render profile, measuring pages per
+	* second and how far each render drifts from the faithful render of the same page.
+	* Only the page load and render stages are timed, as the text stages do not depend on
+	* the profile.
+	* The ocr-fast profile is measured with both the lean and full document open, to
+	* show the time spent setting up forms and running document actions.
+	*
+	* @param pdf Renderer for the PDF to benchmark.
+	* @param pages Page numbers of the pages to process, in ascending order.
+	* @param options Render options used for every profile, apart from the profile itself.
+	*
+	* @returns A result for each render profile.
+	*/
+	std::vector<RenderProfileResult> BenchmarkRenderProfiles(
+		PdfRenderer& pdf, const std::vector<int>& pages, RenderOptions options);
+	/**
+	* Write render profile benchmark results as a table.
+	*
+	* @param results Results from BenchmarkRenderProfiles.
+	* @param out Stream to write the table to.
+	*/
+	void PrintRenderProfileResults(const std::vector<RenderProfileResult>& results, std::ostream& out);
+} // namespace textextract
+#endif
@@ -0,0 +1,106 @@
+#include "renderoptions.h"
+
+#include "pdfium/fpdfview.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace textextract {
+	std::string RenderStatusToString(RenderStatus status) {
+		switch (status) {
+		case RenderStatus::COMPLETE: return "complete";
+		case RenderStatus::PARTIAL: return "partial";
+		case RenderStatus::LOW_DPI: return "lowdpi";
+		case RenderStatus::SKIPPED: return "skipped";
+		case RenderStatus::FAILED: return "failed";
+		case RenderStatus::NOT_RENDERED: return "not_rendered";
+		case RenderStatus::PASSTHROUGH: return "passthrough";
+		default: return "none";
+		}
+	}
+
+	RenderProfileSettings GetRenderProfileSettings(RenderProfile profile) {
+		RenderProfileSettings settings;
+		switch (profile) {
+		case RenderProfile::DEBUG:
+			settings.flags = FPDF_ANNOT | FPDF_GRAYSCALE;
+			settings.drawForms = false;
+			settings.grayscaleBitmap = true;
+			break;
+		case RenderProfile::OCR_FAST:
+			settings.flags = FPDF_GRAYSCALE | FPDF_RENDER_NO_SMOOTHTEXT |
+				FPDF_RENDER_NO_SMOOTHPATH | FPDF_RENDER_NO_SMOOTHIMAGE;
+			settings.drawForms = false;
+			settings.grayscaleBitmap = true;
+			break;
+		default:
+			settings.flags = FPDF_ANNOT;
+			settings.drawForms = true;
+			settings.grayscaleBitmap = false;
+			break;
+		}
+		return settings;
+	}
+
+	std::string RenderProfileToString(RenderProfile profile) {
+		switch (profile) {
+		case RenderProfile::DEBUG: return "debug";
+		case RenderProfile::OCR_FAST: return "ocr-fast";
+		default: return "faithful";
+		}
+	}
+
+	bool ParseRenderProfile(const std::string& name, RenderProfile& profile) {
+		if (name == "faithful") profile = RenderProfile::FAITHFUL;
+		else if (name == "debug") profile = RenderProfile::DEBUG;
+		else if (name == "ocr-fast") profile = RenderProfile::OCR_FAST;
+		else return false;
+		return true;
+	}
+
+	bool UsesFormEnvironment(const RenderOptions& options) {
+		switch (options.openMode) {
+		case DocumentOpenMode::FULL: return true;
+		case DocumentOpenMode::LEAN: return false;
+		default: return GetRenderProfileSettings(options.profile).drawForms;
+		}
+	}
+
+	bool ParseDocumentOpenMode(const std::string& name, DocumentOpenMode& mode) {
+		if (name == "auto") mode = DocumentOpenMode::AUTO;
+		else if (name == "full") mode = DocumentOpenMode::FULL;
+		else if (name == "lean") mode = DocumentOpenMode::LEAN;
+		else return false;
+		return true;
+	}
+
+	int ChooseRenderDpi(const PageSize& pageSize, const RenderOptions& options) {
+		int dpi = options.dpi;
+		// Grayscale profiles render into one byte per pixel, the others into four.
+		long long bytesperpixel = GetRenderProfileSettings(options.profile).grayscaleBitmap ? 1 : 4;
+		long long pixelbudget = options.maxPixels;
+		if (options.maxRenderBytes > 0) {
+			long long bytebudget = options.maxRenderBytes / bytesperpixel;
+			pixelbudget = pixelbudget > 0 ? std::min(pixelbudget, bytebudget) : bytebudget;
+		}
+		double pagearea = static_cast<double>(pageSize.GetPageDimensions().width) *
+			pageSize.GetPageDimensions().height;
+		if (pixelbudget > 0 && pagearea > 0) {
+			// Pixel count grows with the square of the dpi, where a page measured in
+			// points covers (width / 72 * dpi) * (height / 72 * dpi) pixels.
+			int fitdpi = static_cast<int>(std::floor(72.0 * std::sqrt(pixelbudget / pagearea)));
+			dpi = std::min(dpi, fitdpi);
+		}
+		if (options.maxDpi > 0) dpi = std::min(dpi, options.maxDpi);
+		dpi = std::max(dpi, options.minDpi);
+		return std::max(dpi, 1);
+	}
+
+	bool ParseRenderTimeoutAction(const std::string& name, RenderTimeoutAction& action) {
+		if (name == "partial") action = RenderTimeoutAction::PARTIAL;
+		else if (name == "lowdpi") action = RenderTimeoutAction::LOW_DPI;
+		else if (name == "skip") action = RenderTimeoutAction::SKIP;
+		else return false;
+		return true;
+	}
+} // namespace textextract
@@ -0,0 +1,187 @@
+#ifndef RENDER_OPTIONS
+#define RENDER_OPTIONS
+
+#include "regionofinterest.h"
+#include "viewutils.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace textextract {
+	// Outcome of rendering a page.
+	enum class RenderStatus {
+		NONE = 0,
+		COMPLETE = 1,
+		// The render deadline passed and the render only contains what was drawn before it.
+		PARTIAL = 2,
+		// The render deadline passed and the page was rendered again at the timeout dpi.
+		LOW_DPI = 3,
+		// The render deadline passed and the render was dropped.
+		SKIPPED = 4,
+		FAILED = 5,
+		// The page was classified as text only and not rendered.
+		NOT_RENDERED = 6,
+		// The page's embedded image was written with its original encoding instead of a render.
+		PASSTHROUGH = 7
+	};
+
+	// What to do with a page render that exceeds its render deadline.
+	enum class RenderTimeoutAction {
+		PARTIAL = 0,
+		LOW_DPI = 1,
+		SKIP = 2
+	};
+
+	// Named sets of pdfium render settings, trading render fidelity for speed.
+	enum class RenderProfile {
+		// Annotations and form fields drawn with anti-aliasing, matching a viewer.
+		FAITHFUL = 0,
+		// Annotations drawn into a grayscale bitmap, form fields are skipped.
+		DEBUG = 1,
+		// Page content only, drawn into a grayscale bitmap without anti-aliasing.
+		OCR_FAST = 2
+	};
+
+	// How much of the pdfium form fill environment is set up when a document is opened.
+	enum class DocumentOpenMode {
+		// Set up the form fill environment only when the render profile draws form fields.
+		AUTO = 0,
+		// Always set up the form fill environment and run the document and page actions.
+		FULL = 1,
+		// Never set up the form fill environment, form fields are not drawn.
+		LEAN = 2
+	};
+
+	/**
+	* @brief The pdfium settings that a RenderProfile maps to.
+	*/
+	struct RenderProfileSettings {
+		// Page rendering flags passed to pdfium, defined in fpdfview.h.
+		int flags = 0;
+		// Whether or not form fields are drawn on top of the page.
+		bool drawForms = true;
+		// Whether or not the page is rendered into a single channel bitmap.
+		bool grayscaleBitmap = false;
+	};
+
+	/**
+	* @brief Settings that control how a page is rendered to an image.
+	*/
+	struct RenderOptions {
+		// Dots Per Inch metric used for rendering page to a desired resolution.
+		int dpi = 300;
+		// Height in pixels of each band when rendering a page in tiles, 0 renders
+		// the page as a single bitmap.
+		int tileHeight = 0;
+		// Directory to stream page renders to as PNG files. When empty, the render
+		// is kept in memory as part of the page information.
+		std::filesystem::path renderDirectory;
+		// Name prefixed to each streamed render file, usually the stem of the PDF.
+		std::string renderFilePrefix;
+		// Time allowed for rendering a single page in milliseconds, 0 disables the limit.
+		int renderTimeoutMs = 0;
+		// What to do with the render of a page once its time limit is exceeded.
+		RenderTimeoutAction timeoutAction = RenderTimeoutAction::PARTIAL;
+		// Resolution used when a render is retried with RenderTimeoutAction::LOW_DPI.
+		int timeoutDpi = 72;
+		// Largest number of pixels a single page render may have, 0 for no limit.
+		long long maxPixels = 0;
+		// Largest size in bytes of the bitmap for a single page render, 0 for no limit.
+		long long maxRenderBytes = 0;
+		// Lowest resolution the render budget may reduce a page to.
+		int minDpi = 0;
+		// Highest resolution a page may be rendered at, 0 for no limit.
+		int maxDpi = 0;
+		// Trade off between render fidelity and speed.
+		RenderProfile profile = RenderProfile::FAITHFUL;
+		// Whether or not the form fill environment is set up when opening the document.
+		DocumentOpenMode openMode = DocumentOpenMode::AUTO;
+		// Whether or not pages classified as text only are left unrendered.
+		bool skipTextOnlyRender = false;
+		// Whether or not pages that are a single embedded image have the image written
+		// with its original encoding, instead of being rendered.
+		bool imagePassthrough = false;
+		// Directory the embedded images of passed through pages are written to.
+		std::filesystem::path imageDirectory;
+		// Regions of the page text is extracted from, the whole page when empty.
+		std::vector<PageRegion> regions;
+		// Units the regions are given in.
+		RegionUnit regionUnit = RegionUnit::POINTS;
+	};
+
+	/**
+	* Determine if the form fill environment, along with the document JavaScript and
+	* open actions, needs to be set up to render with the given options.
+	*
+	* @param options The render options.
+	*
+	* @returns True if the full document open path should be used.
+	*/
+	bool UsesFormEnvironment(const RenderOptions& options);
+	/**
+	* Parse the name of a document open mode.
+	*
+	* @param name One of "auto", "full" or "lean".
+	* @param mode Set to the parsed mode if the name is valid.
+	*
+	* @returns True if the name was a valid document open mode.
+	*/
+	bool ParseDocumentOpenMode(const std::string& name, DocumentOpenMode& mode);
+
+	/**
+	* Get the pdfium settings for a render profile.
+	*
+	* @param profile The render profile.
+	*
+	* @returns RenderProfileSettings describing how to render with the profile.
+	*/
+	RenderProfileSettings GetRenderProfileSettings(RenderProfile profile);
+	/**
+	* Get the name of a render profile, as accepted on the command line.
+	*
+	* @param profile The render profile to name.
+	*
+	* @returns The name of the profile as a string.
+	*/
+	std::string RenderProfileToString(RenderProfile profile);
+	/**
+	* Parse the name of a render profile.
+	*
+	* @param name One of "faithful", "debug" or "ocr-fast".
+	* @param profile Set to the parsed profile if the name is valid.
+	*
+	* @returns True if the name was a valid render profile.
+	*/
+	bool ParseRenderProfile(const std::string& name, RenderProfile& profile);
+
+	/**
+	* Choose the resolution to render a page at. The requested dpi is lowered until the
+	* render fits within the pixel and byte budgets, then clamped to the min and max dpi.
+	*
+	* @param pageSize Size of the page to be rendered, in points.
+	* @param options Render options holding the requested dpi and budgets.
+	*
+	* @returns The effective dpi for the page.
+	*/
+	int ChooseRenderDpi(const PageSize& pageSize, const RenderOptions& options);
+
+	/**
+	* Get the name of a render status, as written to the extraction result.
+	*
+	* @param status The render status to name.
+	*
+	* @returns The name of the status as a string.
+	*/
+	std::string RenderStatusToString(RenderStatus status);
+	/**
+	* Parse the name of a render timeout action.
+	*
+	* @param name One of "partial", "lowdpi" or "skip".
+	* @param action Set to the parsed action if the name is valid.
+	*
+	* @returns True if the name was a valid timeout action.
+	*/
+	bool ParseRenderTimeoutAction(const std::string& name, RenderTimeoutAction& action);
+} // namespace textextract
+#endif
@@ -0,0 +1,97 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "rendersink.h"
+
+#include "libpng16/png.h"
+
+#include <iostream>
+
+namespace textextract {
+	bool MatRenderSink::Begin(int width, int height) {
+		mRender.create(height, width, CV_8UC1);
+		mNextRow = 0;
+		return !mRender.empty();
+	}
+
+	bool MatRenderSink::WriteBand(const cv::Mat& band) {
+		if (mNextRow + band.rows > mRender.rows || band.cols != mRender.cols) {
+			return false;
+		}
+		band.copyTo(mRender.rowRange(mNextRow, mNextRow + band.rows));
+		mNextRow += band.rows;
+		return true;
+	}
+
+	bool MatRenderSink::End() {
+		return mNextRow == mRender.rows;
+	}
+
+	PngFileRenderSink::~PngFileRenderSink() {
+		Close();
+	}
+
+	void PngFileRenderSink::Close() {
+		png_structp png = static_cast<png_structp>(mPng);
+		png_infop info = static_cast<png_infop>(mPngInfo);
+		if (png) {
+			png_destroy_write_struct(&png, info ? &info : nullptr);
+		}
+		mPng = nullptr;
+		mPngInfo = nullptr;
+		if (mFile) {
+			fclose(mFile);
+			mFile = nullptr;
+		}
+	}
+
+	bool PngFileRenderSink::Begin(int width, int height) {
+		mFile = fopen(mFilePath.string().c_str(), "wb");
+		if (!mFile) {
+			std::cerr << "Failed to open render file: " << mFilePath.string() << std::endl;
+			return false;
+		}
+		png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+		png_infop info = png ? png_create_info_struct(png) : nullptr;
+		mPng = png;
+		mPngInfo = info;
+		if (!png || !info) {
+			Close();
+			return false;
+		}
+		// libpng reports errors by jumping back here.
+		if (setjmp(png_jmpbuf(png))) {
+			Close();
+			return false;
+		}
+		png_init_io(png, mFile);
+		png_set_IHDR(
+			png, info, width, height, 8, PNG_COLOR_TYPE_GRAY,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+		png_write_info(png, info);
+		return true;
+	}
+
+	bool PngFileRenderSink::WriteBand(const cv::Mat& band) {
+		png_structp png = static_cast<png_structp>(mPng);
+		if (!png) return false;
+		if (setjmp(png_jmpbuf(png))) {
+			Close();
+			return false;
+		}
+		for (int row = 0; row < band.rows; row++) {
+			png_write_row(png, const_cast<unsigned char*>(band.ptr<unsigned char>(row)));
+		}
+		return true;
+	}
+
+	bool PngFileRenderSink::End() {
+		png_structp png = static_cast<png_structp>(mPng);
+		if (!png) return false;
+		if (setjmp(png_jmpbuf(png))) {
+			Close();
+			return false;
+		}
+		png_write_end(png, static_cast<png_infop>(mPngInfo));
+		Close();
+		return true;
+	}
+} // namespace textextract
@@ -0,0 +1,91 @@
+#ifndef RENDER_SINK
+#define RENDER_SINK
+
+#include <opencv2/core/mat.hpp>
+
+#include <filesystem>
+
+namespace textextract {
+	/**
+	* @brief Consumer of a page render that receives the render as a sequence of
+	* horizontal bands, from the top of the page to the bottom.
+	*/
+	class RenderSink {
+	public:
+		virtual ~RenderSink() = default;
+		/**
+		* Prepare the sink to receive a render of the given size.
+		*
+		* @param width Width of the full render in pixels.
+		* @param height Height of the full render in pixels.
+		*
+		* @returns True if the sink is ready to receive bands.
+		*/
+		virtual bool Begin(int width, int height) = 0;
+		/**
+		* Append the next band of the render. Bands are single channel grayscale images
+		* with the width given to Begin.
+		*
+		* @param band Image data for the band.
+		*
+		* @returns True if the band was consumed.
+		*/
+		virtual bool WriteBand(const cv::Mat& band) = 0;
+		/**
+		* Finish the render once all bands have been written.
+		*
+		* @returns True if the render was completed successfully.
+		*/
+		virtual bool End() = 0;
+	};
+
+	/**
+	* @brief RenderSink that assembles the bands into a single in-memory image.
+	*/
+	class MatRenderSink : public RenderSink {
+	private:
+		// The assembled render.
+		cv::Mat mRender;
+		// Row of mRender the next band will be copied to.
+		int mNextRow = 0;
+
+	public:
+		bool Begin(int width, int height) override;
+		bool WriteBand(const cv::Mat& band) override;
+		bool End() override;
+		/**
+		* Get the assembled render.
+		*
+		* @returns Image data as a cv::Mat.
+		*/
+		cv::Mat GetRender() const { return mRender; }
+	};
+
+	/**
+	* @brief RenderSink that encodes each band into a PNG file as it arrives, so that
+	* only a single band is held in memory at any time.
+	*/
+	class PngFileRenderSink : public RenderSink {
+	private:
+		// Path to the PNG file being written.
+		std::filesystem::path mFilePath;
+		// Handle to the open PNG file.
+		FILE* mFile = nullptr;
+		// libpng write state, kept opaque to avoid exposing png.h.
+		void* mPng = nullptr;
+		// libpng image information, kept opaque to avoid exposing png.h.
+		void* mPngInfo = nullptr;
+		/**
+		* Release the libpng state and close the file.
+		*/
+		void Close();
+
+	public:
+		PngFileRenderSink(std::filesystem::path filePath) : mFilePath(filePath) {}
+		~PngFileRenderSink();
+		bool Begin(int width, int height) override;
+		bool WriteBand(const cv::Mat& band) override;
+		bool End() override;
+	};
+} // namespace textextract
+#endif
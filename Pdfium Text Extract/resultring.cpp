@@ -0,0 +1,244 @@
+#include "resultring.h"
+
+#include "pdfpageinfo.h"
+
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace textextract {
+#ifdef __linux__
+	namespace {
+		// Slot states, moved FREE -> WRITING -> READY by a worker and back to FREE by the parent.
+		const uint32_t SLOT_FREE = 0;
+		const uint32_t SLOT_WRITING = 1;
+		const uint32_t SLOT_READY = 2;
+
+		// Offsets of each area within a slot are aligned to this many bytes.
+		const size_t SLOT_ALIGNMENT = 64;
+
+		struct RingHeader {
+			uint32_t slotCount;
+			uint64_t slotBytes;
+			// Counts the slots in the FREE state.
+			sem_t freeSlots;
+		};
+
+		struct SlotHeader {
+			std::atomic<uint32_t> state;
+			// Process id of the worker that published the slot.
+			int32_t owner;
+			int32_t pageNumber;
+			int32_t renderStatus;
+			int32_t renderDpi;
+			int32_t renderWidth;
+			int32_t renderHeight;
+			int32_t pageClass;
+			// Words, stored as an array of WordRecord, with their text in the text area.
+			uint32_t wordCount;
+			uint64_t wordsOffset;
+			// Text area holding the text of every word followed by the raw text, as wchar_t.
+			uint64_t textOffset;
+			uint64_t rawTextStart;
+			uint64_t rawTextLength;
+		};
+
+		struct WordRecord {
+			int32_t x;
+			int32_t y;
+			int32_t width;
+			int32_t height;
+			// Position and length of the word in the text area, in characters.
+			uint64_t textStart;
+			uint64_t textLength;
+		};
+
+		size_t Align(size_t bytes) {
+			return (bytes + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+		}
+
+		RingHeader* GetHeader(unsigned char* mapping) {
+			return reinterpret_cast<RingHeader*>(mapping);
+		}
+	} // namespace
+
+	ResultRing::~ResultRing() {
+		if (mMapping) {
+			munmap(mMapping, mMappingBytes);
+			close(mFd);
+		}
+	}
+
+	unsigned char* ResultRing::GetSlot(int slot) const {
+		RingHeader* header = GetHeader(mMapping);
+		return mMapping + Align(sizeof(RingHeader)) + static_cast<size_t>(slot) * header->slotBytes;
+	}
+
+	bool ResultRing::Create(int slotCount, size_t slotBytes) {
+		slotBytes = Align(slotBytes);
+		mMappingBytes = Align(sizeof(RingHeader)) + static_cast<size_t>(slotCount) * slotBytes;
+		mFd = memfd_create("textextract-results", MFD_CLOEXEC);
+		if (mFd < 0 || ftruncate(mFd, mMappingBytes) != 0) {
+			std::cerr << "Failed to create the shared result ring: " << strerror(errno) << std::endl;
+			if (mFd >= 0) close(mFd);
+			mFd = -1;
+			return false;
+		}
+		void* mapping = mmap(nullptr, mMappingBytes, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+		if (mapping == MAP_FAILED) {
+			std::cerr << "Failed to map the shared result ring: " << strerror(errno) << std::endl;
+			close(mFd);
+			mFd = -1;
+			return false;
+		}
+		mMapping = static_cast<unsigned char*>(mapping);
+		RingHeader* header = GetHeader(mMapping);
+		header->slotCount = slotCount;
+		header->slotBytes = slotBytes;
+		sem_init(&header->freeSlots, 1, slotCount);
+		for (int i = 0; i < slotCount; i++) {
+			new (GetSlot(i)) SlotHeader();
+			reinterpret_cast<SlotHeader*>(GetSlot(i))->state.store(SLOT_FREE);
+		}
+		return true;
+	}
+
+	int ResultRing::Publish(int pageNumber) {
+		if (!mMapping || GetRenderStatus() == RenderStatus::PASSTHROUGH) return -1;
+		RingHeader* header = GetHeader(mMapping);
+		std::vector<TextBox> words = GetPageWords();
+		std::wstring rawtext = GetRawPageText();
+
+		// Lay the slot out and check the page fits before taking a slot.
+		size_t textlength = rawtext.size();
+		for (const auto& word : words) textlength += word.GetText().size();
+		size_t wordsoffset = Align(sizeof(SlotHeader));
+		size_t textoffset = Align(wordsoffset + words.size() * sizeof(WordRecord));
+		size_t slotbytes = textoffset + textlength * sizeof(wchar_t);
+		if (slotbytes > header->slotBytes) return -1;
+
+		while (sem_wait(&header->freeSlots) != 0) {
+			if (errno != EINTR) return -1;
+		}
+		int slot = -1;
+		for (uint32_t i = 0; i < header->slotCount && slot < 0; i++) {
+			uint32_t expected = SLOT_FREE;
+			SlotHeader* candidate = reinterpret_cast<SlotHeader*>(GetSlot(i));
+			if (candidate->state.compare_exchange_strong(expected, SLOT_WRITING)) slot = i;
+		}
+		if (slot < 0) {
+			sem_post(&header->freeSlots);
+			return -1;
+		}
+
+		unsigned char* base = GetSlot(slot);
+		SlotHeader* slotheader = reinterpret_cast<SlotHeader*>(base);
+		slotheader->owner = getpid();
+		slotheader->pageNumber = pageNumber;
+		slotheader->renderStatus = static_cast<int32_t>(GetRenderStatus());
+		slotheader->renderDpi = GetRenderDpi();
+		slotheader->renderWidth = GetRenderDimensions().width;
+		slotheader->renderHeight = GetRenderDimensions().height;
+		slotheader->pageClass = static_cast<int32_t>(GetPageClass());
+
+		slotheader->wordCount = static_cast<uint32_t>(words.size());
+		slotheader->wordsOffset = wordsoffset;
+		slotheader->textOffset = textoffset;
+		WordRecord* records = reinterpret_cast<WordRecord*>(base + wordsoffset);
+		wchar_t* text = reinterpret_cast<wchar_t*>(base + textoffset);
+		size_t textposition = 0;
+		for (size_t i = 0; i < words.size(); i++) {
+			cv::Rect bounds = words[i].GetBounds();
+			std::wstring wordtext = words[i].GetText();
+			records[i] = { bounds.x, bounds.y, bounds.width, bounds.height, textposition, wordtext.size() };
+			std::copy(wordtext.begin(), wordtext.end(), text + textposition);
+			textposition += wordtext.size();
+		}
+		slotheader->rawTextStart = textposition;
+		slotheader->rawTextLength = rawtext.size();
+		std::copy(rawtext.begin(), rawtext.end(), text + textposition);
+
+		slotheader->state.store(SLOT_READY, std::memory_order_release);
+		ClearPageInfo();
+		return slot;
+	}
+
+	int ResultRing::Load(int slot) {
+		if (!mMapping) return 0;
+		RingHeader* header = GetHeader(mMapping);
+		if (slot < 0 || static_cast<uint32_t>(slot) >= header->slotCount) return 0;
+		unsigned char* base = GetSlot(slot);
+		SlotHeader* slotheader = reinterpret_cast<SlotHeader*>(base);
+		if (slotheader->state.load(std::memory_order_acquire) != SLOT_READY) return 0;
+
+		ClearPageInfo();
+		SetRenderDimensions(PageDimensions(slotheader->renderWidth, slotheader->renderHeight));
+		SetRenderStatus(static_cast<RenderStatus>(slotheader->renderStatus));
+		SetRenderDpi(slotheader->renderDpi);
+		SetPageClass(static_cast<PageClass>(slotheader->pageClass));
+
+		const WordRecord* records = reinterpret_cast<const WordRecord*>(base + slotheader->wordsOffset);
+		const wchar_t* text = reinterpret_cast<const wchar_t*>(base + slotheader->textOffset);
+		std::vector<TextBox> words;
+		words.reserve(slotheader->wordCount);
+		for (uint32_t i = 0; i < slotheader->wordCount; i++) {
+			const WordRecord& record = records[i];
+			words.emplace_back(cv::Rect(record.x, record.y, record.width, record.height),
+				std::wstring(text + record.textStart, record.textLength));
+		}
+		SetPageWords(words);
+		SetRawPageText(std::wstring(text + slotheader->rawTextStart, slotheader->rawTextLength));
+		return slotheader->pageNumber;
+	}
+
+	void ResultRing::Release(int slot) {
+		if (!mMapping) return;
+		RingHeader* header = GetHeader(mMapping);
+		if (slot < 0 || static_cast<uint32_t>(slot) >= header->slotCount) return;
+		SlotHeader* slotheader = reinterpret_cast<SlotHeader*>(GetSlot(slot));
+		if (slotheader->state.exchange(SLOT_FREE) != SLOT_FREE) sem_post(&header->freeSlots);
+	}
+
+	void ResultRing::ReclaimFrom(int pid) {
+		if (!mMapping) return;
+		RingHeader* header = GetHeader(mMapping);
+		for (uint32_t i = 0; i < header->slotCount; i++) {
+			SlotHeader* slotheader = reinterpret_cast<SlotHeader*>(GetSlot(i));
+			if (slotheader->state.load() != SLOT_FREE && slotheader->owner == pid) Release(i);
+		}
+	}
+#else
+	ResultRing::~ResultRing() {}
+
+	unsigned char* ResultRing::GetSlot(int slot) const {
+		return nullptr;
+	}
+
+	bool ResultRing::Create(int slotCount, size_t slotBytes) {
+		std::cerr << "The shared result ring is only supported on Linux, workers write their own output." << std::endl;
+		return false;
+	}
+
+	int ResultRing::Publish(int pageNumber) {
+		return -1;
+	}
+
+	int ResultRing::Load(int slot) {
+		return 0;
+	}
+
+	void ResultRing::Release(int slot) {}
+
+	void ResultRing::ReclaimFrom(int pid) {}
+#endif
+} // namespace textextract
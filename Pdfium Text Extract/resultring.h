@@ -0,0 +1,82 @@
+#ifndef RESULT_RING
+#define RESULT_RING
+
+#include <cstddef>
+#include <cstdint>
+
+namespace textextract {
+	/**
+	* @brief Fixed size slots of shared memory that page workers move their page information
+	* into, for the parent to write the output from in place.
+	*
+	* The ring is a memfd mapped shared before the workers are forked. A slot holds one page
+	* in a fixed binary layout: a header with the render details, the words as bounds with
+	* offsets into a text area, and the raw text. The render pixels are not published, as the
+	* output only needs the render's details, and any render image file is written by the
+	* worker. Free slots are counted by a process-shared semaphore, so once every slot is
+	* waiting to be written out, workers block until the parent releases one. Only supported
+	* on Linux.
+	*/
+	class ResultRing {
+	private:
+		// Start of the shared mapping, null until the ring is created.
+		unsigned char* mMapping = nullptr;
+		size_t mMappingBytes = 0;
+		int mFd = -1;
+
+		unsigned char* GetSlot(int slot) const;
+
+	public:
+		ResultRing() = default;
+		ResultRing(const ResultRing&) = delete;
+		ResultRing& operator=(const ResultRing&) = delete;
+		~ResultRing();
+		/**
+		* Create and map the shared memory of the ring. Must be called before forking the
+		* workers that publish to it.
+		*
+		* @param slotCount Number of slots.
+		* @param slotBytes Size of each slot in bytes, bounding the size of a page's words and text.
+		*
+		* @returns True if the ring was created.
+		*/
+		bool Create(int slotCount, size_t slotBytes);
+		/**
+		* Determine if the ring was created.
+		*
+		* @returns True if the ring can be published to.
+		*/
+		bool IsCreated() const { return mMapping != nullptr; }
+		/**
+		* Move the information of the current page into a free slot, waiting for one if they
+		* are all in use. The current page information is cleared once it is in the slot.
+		* Pages with a passthrough image, or too large for a slot, are not published.
+		*
+		* @param pageNumber One based page number.
+		*
+		* @returns The slot the page was published to, or -1 if it was not published.
+		*/
+		int Publish(int pageNumber);
+		/**
+		* Set the current page information from a published slot, leaving the render empty.
+		*
+		* @param slot Slot returned by Publish.
+		*
+		* @returns The page number of the slot, 0 if the slot does not hold a page.
+		*/
+		int Load(int slot);
+		/**
+		* Return a slot to the ring once its page is written.
+		*
+		* @param slot Slot returned by Publish.
+		*/
+		void Release(int slot);
+		/**
+		* Release the slots held by a worker that died while writing to or publishing them.
+		*
+		* @param pid Process id of the worker.
+		*/
+		void ReclaimFrom(int pid);
+	};
+} // namespace textextract
+#endif
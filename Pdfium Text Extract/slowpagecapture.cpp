@@ -0,0 +1,62 @@
+#include "slowpagecapture.h"
+
+#include "pdfpageinfo.h"
+#include "stagetimer.h"
+
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+namespace textextract {
+	bool CaptureSlowPage(PdfRenderer& pdf, int pageNumber, double elapsedMs, double thresholdMs,
+		const std::filesystem::path& triageDirectory, const std::string& fileName) {
+		std::error_code error;
+		std::filesystem::create_directories(triageDirectory, error);
+		if (error) {
+			std::cerr << "Error creating the triage directory: " << triageDirectory.string() << std::endl;
+			return false;
+		}
+
+		std::string pdfdata;
+		if (!pdf.ExtractPage(pageNumber, pdfdata)) {
+			std::cerr << "Error copying slow page " << pageNumber + 1 << " to a new PDF." << std::endl;
+			return false;
+		}
+		std::string name = fileName + "pg" + std::to_string(pageNumber + 1);
+		std::filesystem::path pdfpath = triageDirectory / (name + ".pdf");
+		std::ofstream pdffile(pdfpath, std::ios::binary);
+		if (!pdffile.is_open()) {
+			std::cerr << "Error opening the reproducer file: " << pdfpath.string() << std::endl;
+			return false;
+		}
+		pdffile.write(pdfdata.data(), pdfdata.size());
+		pdffile.close();
+
+		nlohmann::json j;
+		j["source_file"] = fileName;
+		j["source_page"] = pageNumber + 1;
+		j["elapsed_ms"] = elapsedMs;
+		j["threshold_ms"] = thresholdMs;
+		j["stages_ms"] = GetPageStageTimes();
+		j["page_size"] = {
+			{"width", GetPageSize().GetPageDimensions().width},
+			{"height", GetPageSize().GetPageDimensions().height}
+		};
+		j["render_status"] = RenderStatusToString(GetRenderStatus());
+		j["render_dpi"] = GetRenderDpi();
+		j["render_size"] = {
+			{"width", GetRenderDimensions().width},
+			{"height", GetRenderDimensions().height}
+		};
+		std::filesystem::path timingspath = triageDirectory / (name + ".timings.json");
+		std::ofstream timingsfile(timingspath);
+		if (!timingsfile.is_open()) {
+			std::cerr << "Error opening the timings file: " << timingspath.string() << std::endl;
+			return false;
+		}
+		timingsfile << j.dump(4);
+		std::cout << "captured slow page " << pageNumber + 1 << " (" << elapsedMs << " ms) to "
+			<< pdfpath.string() << std::endl;
+		return true;
+	}
+} // namespace textextract
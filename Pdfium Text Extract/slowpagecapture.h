@@ -0,0 +1,27 @@
+#ifndef SLOW_PAGE_CAPTURE
+#define SLOW_PAGE_CAPTURE
+
+#include <filesystem>
+#include <string>
+
+#include "pdfrenderer.h"
+
+namespace textextract {
+	/**
+	* Save a page that took longer than the slow page threshold as a standalone PDF in the
+	* triage directory, next to a JSON file of its stage timings and render result. The
+	* reproducer holds only that page, so it can be shared without the source document.
+	*
+	* @param pdf Renderer holding the source document.
+	* @param pageNumber Zero based page number of the slow page.
+	* @param elapsedMs Time the page took to process, in milliseconds.
+	* @param thresholdMs Slow page threshold that was exceeded, in milliseconds.
+	* @param triageDirectory Directory to write the reproducer and timings to.
+	* @param fileName Name of the source document, used to name the reproducer.
+	*
+	* @returns True if both files were written.
+	*/
+	bool CaptureSlowPage(PdfRenderer& pdf, int pageNumber, double elapsedMs, double thresholdMs,
+		const std::filesystem::path& triageDirectory, const std::string& fileName);
+} // namespace textextract
+#endif
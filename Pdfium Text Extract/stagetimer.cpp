@@ -0,0 +1,300 @@
+#include "stagetimer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace textextract {
+	namespace {
+		const int STAGE_COUNT = static_cast<int>(Stage::STAGE_COUNT);
+		// Buckets per power of two in a StageHistogram.
+		const double BUCKETS_PER_DOUBLING = 4.0;
+
+		struct StageMemory {
+			// Whether or not any heap use was recorded for the stage.
+			bool recorded = false;
+			// Bytes allocated over every run of the stage.
+			uint64_t allocatedBytes = 0;
+			// Most bytes held at the end of a run of the stage.
+			int64_t peakLiveBytes = 0;
+
+			void Merge(const StageMemory& other) {
+				if (!other.recorded) return;
+				peakLiveBytes = recorded ? std::max(peakLiveBytes, other.peakLiveBytes) : other.peakLiveBytes;
+				allocatedBytes += other.allocatedBytes;
+				recorded = true;
+			}
+		};
+
+		struct StageStats {
+			std::array<StageHistogram, STAGE_COUNT> stages;
+			// Hardware events summed over every run of each stage.
+			std::array<PerfCounts, STAGE_COUNT> counters;
+			// Heap use of each stage.
+			std::array<StageMemory, STAGE_COUNT> memory;
+		};
+
+		bool mEnabled = false;
+		std::mutex mStatsMutex;
+		std::string mDocumentName;
+		StageStats mDocumentStats;
+		StageStats mRunStats;
+		nlohmann::json mDocumentReports = nlohmann::json::array();
+		// Page pipeline of the current document, null when pages were processed in sequence.
+		nlohmann::json mDocumentPipeline;
+		// Microseconds spent in each stage for the current page of this thread, so that the
+		// threads of a page pipeline do not add their stages to the page being extracted.
+		thread_local std::array<double, STAGE_COUNT> mPageTimes{};
+		// Memory of each page of the current document.
+		nlohmann::json mPageMemory = nlohmann::json::array();
+		// Memory readings when the current document started and after the last page.
+		ProcessMemory mDocumentStartMemory;
+		ProcessMemory mLastMemory;
+		uint64_t mLastAllocated = 0;
+		// Steps of progress counted over the run, read by the heartbeat thread of a worker.
+		std::atomic<uint64_t> mProgress{ 0 };
+		std::atomic<bool> mProgressEnabled{ false };
+
+		nlohmann::json CountersToJson(const PerfCounts& counts) {
+			nlohmann::json j;
+			j["cycles"] = counts.cycles;
+			j["instructions"] = counts.instructions;
+			j["cache_misses"] = counts.cacheMisses;
+			j["branch_misses"] = counts.branchMisses;
+			j["ipc"] = counts.cycles > 0 ?
+				static_cast<double>(counts.instructions) / counts.cycles : 0.0;
+			return j;
+		}
+
+		nlohmann::json StatsToJson(const StageStats& stats) {
+			nlohmann::json j = nlohmann::json::object();
+			for (int i = 0; i < STAGE_COUNT; i++) {
+				if (stats.stages[i].GetCount() > 0) {
+					nlohmann::json stage = stats.stages[i].ToJson();
+					if (stats.counters[i].cycles > 0) {
+						stage["counters"] = CountersToJson(stats.counters[i]);
+					}
+					if (stats.memory[i].recorded) {
+						stage["memory"] = {
+							{"allocated_bytes", stats.memory[i].allocatedBytes},
+							{"peak_live_bytes", stats.memory[i].peakLiveBytes}
+						};
+					}
+					j[StageToString(static_cast<Stage>(i))] = stage;
+				}
+			}
+			return j;
+		}
+	} // namespace
+
+	const char* StageToString(Stage stage) {
+		switch (stage) {
+		case Stage::DOCUMENT_LOAD: return "document_load";
+		case Stage::PAGE_LOAD: return "page_load";
+		case Stage::TEXT_PAGE_LOAD: return "text_page_load";
+		case Stage::CLASSIFY: return "classify";
+		case Stage::RENDER: return "render";
+		case Stage::PNG_ROUND_TRIP: return "png_round_trip";
+		case Stage::RAW_TEXT: return "raw_text";
+		case Stage::TOKENIZE: return "tokenize";
+		case Stage::BOX_MATCH: return "box_match";
+		case Stage::WATERMARK_FILTER: return "watermark_filter";
+		case Stage::RESCALE: return "rescale";
+		case Stage::SERIALIZE: return "serialize";
+		case Stage::WRITE_OUTPUT: return "write_output";
+		case Stage::PAGE_TOTAL: return "page_total";
+		default: return "unknown";
+		}
+	}
+
+	void StageHistogram::Add(double micros) {
+		int bucket = 0;
+		if (micros > 1.0) {
+			bucket = static_cast<int>(std::ceil(std::log2(micros) * BUCKETS_PER_DOUBLING));
+			bucket = std::min(bucket, BUCKET_COUNT - 1);
+		}
+		mBuckets[bucket]++;
+		mCount++;
+		mTotal += micros;
+		mMax = std::max(mMax, micros);
+	}
+
+	void StageHistogram::Merge(const StageHistogram& other) {
+		for (int i = 0; i < BUCKET_COUNT; i++) {
+			mBuckets[i] += other.mBuckets[i];
+		}
+		mCount += other.mCount;
+		mTotal += other.mTotal;
+		mMax = std::max(mMax, other.mMax);
+	}
+
+	double StageHistogram::Percentile(double percentile) const {
+		if (mCount == 0) return 0.0;
+		uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * mCount));
+		rank = std::max<uint64_t>(rank, 1);
+		uint64_t seen = 0;
+		for (int i = 0; i < BUCKET_COUNT; i++) {
+			seen += mBuckets[i];
+			if (seen >= rank) {
+				return std::min(std::pow(2.0, i / BUCKETS_PER_DOUBLING), mMax);
+			}
+		}
+		return mMax;
+	}
+
+	nlohmann::json StageHistogram::ToJson() const {
+		const double MICROS_PER_MILLI = 1000.0;
+		nlohmann::json j;
+		j["count"] = mCount;
+		j["total_ms"] = mTotal / MICROS_PER_MILLI;
+		j["p50_ms"] = Percentile(50) / MICROS_PER_MILLI;
+		j["p95_ms"] = Percentile(95) / MICROS_PER_MILLI;
+		j["p99_ms"] = Percentile(99) / MICROS_PER_MILLI;
+		j["max_ms"] = mMax / MICROS_PER_MILLI;
+		return j;
+	}
+
+	void EnableStageStats(bool enabled) {
+		mEnabled = enabled;
+	}
+
+	bool StageStatsEnabled() {
+		return mEnabled;
+	}
+
+	void RecordStageTime(Stage stage, double micros) {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		mDocumentStats.stages[static_cast<int>(stage)].Add(micros);
+		mPageTimes[static_cast<int>(stage)] += micros;
+	}
+
+	void ResetPageStageTimes() {
+		mPageTimes.fill(0.0);
+	}
+
+	nlohmann::json GetPageStageTimes() {
+		const double MICROS_PER_MILLI = 1000.0;
+		nlohmann::json j = nlohmann::json::object();
+		for (int i = 0; i < STAGE_COUNT; i++) {
+			if (mPageTimes[i] > 0.0) {
+				j[StageToString(static_cast<Stage>(i))] = mPageTimes[i] / MICROS_PER_MILLI;
+			}
+		}
+		return j;
+	}
+
+	void RecordStageCounters(Stage stage, const PerfCounts& counts) {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		mDocumentStats.counters[static_cast<int>(stage)] += counts;
+	}
+
+	void RecordStageMemory(Stage stage, uint64_t allocatedBytes, int64_t liveBytes) {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		StageMemory memory;
+		memory.recorded = true;
+		memory.allocatedBytes = allocatedBytes;
+		memory.peakLiveBytes = liveBytes;
+		mDocumentStats.memory[static_cast<int>(stage)].Merge(memory);
+	}
+
+	void RecordPageMemory(int pageNumber, uint64_t renderBytes) {
+		ProcessMemory memory = ReadProcessMemory();
+		uint64_t allocated = GetAllocatedBytes();
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		nlohmann::json page;
+		page["page"] = pageNumber;
+		if (AllocationCountingAvailable()) {
+			page["allocated_bytes"] = allocated - mLastAllocated;
+			page["live_bytes"] = GetLiveBytes();
+		}
+		page["render_bytes"] = renderBytes;
+		page["bitmap_bytes"] = GetBitmapBytes();
+		page["rss_bytes"] = memory.rssBytes;
+		page["rss_delta_bytes"] = static_cast<int64_t>(memory.rssBytes) -
+			static_cast<int64_t>(mLastMemory.rssBytes);
+		page["peak_rss_bytes"] = memory.peakRssBytes;
+		page["peak_rss_delta_bytes"] = memory.peakRssBytes - mLastMemory.peakRssBytes;
+		mPageMemory.push_back(page);
+		mLastMemory = memory;
+		mLastAllocated = allocated;
+		ResetBitmapBytes();
+	}
+
+	void BeginDocumentStats(const std::string& documentName) {
+		ProcessMemory memory = ReadProcessMemory();
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		mDocumentName = documentName;
+		mDocumentStats = StageStats();
+		mPageMemory = nlohmann::json::array();
+		mDocumentPipeline = nullptr;
+		mDocumentStartMemory = memory;
+		mLastMemory = memory;
+		mLastAllocated = GetAllocatedBytes();
+	}
+
+	void EndDocumentStats() {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		nlohmann::json report;
+		report["name"] = mDocumentName;
+		report["pages"] = mDocumentStats.stages[static_cast<int>(Stage::PAGE_TOTAL)].GetCount();
+		report["stages"] = StatsToJson(mDocumentStats);
+		if (MemoryTrackingEnabled()) {
+			ProcessMemory memory = ReadProcessMemory();
+			report["memory"] = {
+				{"rss_start_bytes", mDocumentStartMemory.rssBytes},
+				{"rss_end_bytes", memory.rssBytes},
+				{"peak_rss_bytes", memory.peakRssBytes},
+				{"peak_rss_delta_bytes", memory.peakRssBytes - mDocumentStartMemory.peakRssBytes},
+				{"pages", mPageMemory}
+			};
+		}
+		if (!mDocumentPipeline.is_null()) report["pipeline"] = mDocumentPipeline;
+		mDocumentReports.push_back(report);
+		for (int i = 0; i < STAGE_COUNT; i++) {
+			mRunStats.stages[i].Merge(mDocumentStats.stages[i]);
+			mRunStats.counters[i] += mDocumentStats.counters[i];
+			mRunStats.memory[i].Merge(mDocumentStats.memory[i]);
+		}
+		mDocumentStats = StageStats();
+	}
+
+	void RecordDocumentPipeline(const nlohmann::json& pipeline) {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		mDocumentPipeline = pipeline;
+	}
+
+	void EnableProgress() {
+		mProgressEnabled.store(true, std::memory_order_relaxed);
+	}
+
+	void NoteProgress() {
+		if (mProgressEnabled.load(std::memory_order_relaxed)) {
+			mProgress.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	uint64_t GetProgress() {
+		return mProgress.load(std::memory_order_relaxed);
+	}
+
+	bool WriteStageStats(const std::filesystem::path& statsPath) {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		nlohmann::json j;
+		j["run"] = StatsToJson(mRunStats);
+		if (MemoryTrackingEnabled()) {
+			j["peak_rss_bytes"] = ReadProcessMemory().peakRssBytes;
+		}
+		j["documents"] = mDocumentReports;
+		std::ofstream file(statsPath);
+		if (!file.is_open()) {
+			std::cerr << "Error opening the stats file: " << statsPath.string() << std::endl;
+			return false;
+		}
+		file << j.dump(4);
+		return true;
+	}
+} // namespace textextract
@@ -0,0 +1,264 @@
+#ifndef STAGE_TIMER
+#define STAGE_TIMER
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "memorystats.h"
+#include "perfcounters.h"
+#include "tracewriter.h"
+
+namespace textextract {
+	// Stages of the per-page extraction pipeline that are timed for the stats report.
+	enum class Stage {
+		DOCUMENT_LOAD = 0,
+		PAGE_LOAD,
+		TEXT_PAGE_LOAD,
+		CLASSIFY,
+		RENDER,
+		PNG_ROUND_TRIP,
+		RAW_TEXT,
+		TOKENIZE,
+		BOX_MATCH,
+		WATERMARK_FILTER,
+		RESCALE,
+		SERIALIZE,
+		WRITE_OUTPUT,
+		// Everything done for a single page by PdfRenderer::GetPageInfo.
+		PAGE_TOTAL,
+		STAGE_COUNT
+	};
+
+	/**
+	* Get the name of a stage, as written to the stats report.
+	*
+	* @param stage The stage to name.
+	*
+	* @returns The name of the stage.
+	*/
+	const char* StageToString(Stage stage);
+
+	/**
+	* @brief Histogram of stage durations with logarithmic buckets, four per power of two,
+	* so that memory use does not grow with the number of pages timed.
+	*/
+	class StageHistogram {
+	private:
+		// Number of buckets, covering 1 microsecond up to about 11 days.
+		static const int BUCKET_COUNT = 160;
+		// Number of recorded durations.
+		uint64_t mCount = 0;
+		// Sum of recorded durations in microseconds.
+		double mTotal = 0.0;
+		// Longest recorded duration in microseconds.
+		double mMax = 0.0;
+		// Number of recorded durations falling in each bucket.
+		std::array<uint64_t, BUCKET_COUNT> mBuckets{};
+
+	public:
+		/**
+		* Record a duration.
+		*
+		* @param micros Duration in microseconds.
+		*/
+		void Add(double micros);
+		/**
+		* Add the durations recorded in another histogram to this one.
+		*
+		* @param other Histogram to merge.
+		*/
+		void Merge(const StageHistogram& other);
+		/**
+		* Estimate a percentile of the recorded durations.
+		*
+		* @param percentile Percentile to estimate, between 0 and 100.
+		*
+		* @returns The upper bound of the bucket holding the percentile, in microseconds.
+		*/
+		double Percentile(double percentile) const;
+		/**
+		* Get the number of recorded durations.
+		*
+		* @returns The count of durations.
+		*/
+		uint64_t GetCount() const { return mCount; }
+		/**
+		* Summarize the histogram as count, total, p50, p95, p99 and max in milliseconds.
+		*
+		* @returns The summary as a JSON object.
+		*/
+		nlohmann::json ToJson() const;
+	};
+
+	/**
+	* Turn stage timing on or off. While off, ScopedStageTimer does not read the clock.
+	*
+	* @param enabled True to record stage timings.
+	*/
+	void EnableStageStats(bool enabled);
+	/**
+	* Determine if stage timings are being recorded.
+	*
+	* @returns True if stage timing is enabled.
+	*/
+	bool StageStatsEnabled();
+	/**
+	* Record how long a stage took, for both the current document and the whole run.
+	*
+	* @param stage The stage that was timed.
+	* @param micros Duration of the stage in microseconds.
+	*/
+	void RecordStageTime(Stage stage, double micros);
+	/**
+	* Record the hardware events counted during a stage, for both the current document
+	* and the whole run.
+	*
+	* @param stage The stage that was measured.
+	* @param counts Events counted while the stage ran.
+	*/
+	void RecordStageCounters(Stage stage, const PerfCounts& counts);
+	/**
+	* Record the heap use of a stage, for both the current document and the whole run.
+	*
+	* @param stage The stage that was measured.
+	* @param allocatedBytes Bytes allocated while the stage ran.
+	* @param liveBytes Bytes held when the stage finished.
+	*/
+	void RecordStageMemory(Stage stage, uint64_t allocatedBytes, int64_t liveBytes);
+	/**
+	* Record the memory cost of a page once it has been processed: the heap allocated
+	* since the previous page, the resident set size and its change, and the size of the
+	* render and of the largest pdfium bitmap used for it. The figures are for the whole
+	* process, so they are only meaningful while pages are processed one at a time.
+	*
+	* @param pageNumber Page number the memory is reported under.
+	* @param renderBytes Size in bytes of the render held for the page.
+	*/
+	void RecordPageMemory(int pageNumber, uint64_t renderBytes);
+	/**
+	* Clear the stage timings kept for the current page. Page timings are kept per
+	* thread, and only hold the stages run on the calling thread.
+	*/
+	void ResetPageStageTimes();
+	/**
+	* Get the time spent in each stage on the calling thread since the page timings were
+	* last reset.
+	*
+	* @returns Milliseconds spent in each stage that ran, keyed by stage name.
+	*/
+	nlohmann::json GetPageStageTimes();
+	/**
+	* Start collecting stage timings for a new document.
+	*
+	* @param documentName Name the document is reported under.
+	*/
+	void BeginDocumentStats(const std::string& documentName);
+	/**
+	* Finish collecting stage timings for the current document and add them to the report.
+	*/
+	void EndDocumentStats();
+	/**
+	* Record how the page pipeline of the current document ran, reported with the
+	* document's stage timings.
+	*
+	* @param pipeline Queue depths and stage utilization of the pipeline.
+	*/
+	void RecordDocumentPipeline(const nlohmann::json& pipeline);
+	/**
+	* Write the per-document and per-run stage histograms to a JSON file.
+	*
+	* @param statsPath Path of the stats file to write.
+	*
+	* @returns True if the file was written.
+	*/
+	bool WriteStageStats(const std::filesystem::path& statsPath);
+	/**
+	* Start counting progress, for a worker process that sends heartbeats. Until then
+	* NoteProgress does nothing, so runs without workers share no counter between threads.
+	*/
+	void EnableProgress();
+	/**
+	* Count a step of progress on the current page once progress is enabled. Steps are
+	* counted at every stage boundary and while a render is drawn, whether or not stats
+	* are enabled, so that a worker only sends heartbeats while its pages move on.
+	*/
+	void NoteProgress();
+	/**
+	* Get the number of steps of progress counted so far.
+	*
+	* @returns The progress count, which only ever increases.
+	*/
+	uint64_t GetProgress();
+
+	/**
+	* @brief Times the enclosing scope as one run of a pipeline stage, adding it to the
+	* stage stats and recording it as a trace span when either is enabled.
+	*/
+	class ScopedStageTimer {
+	private:
+		// The stage being timed.
+		Stage mStage;
+		// Whether or not the duration is added to the stage stats, fixed at construction.
+		bool mStats;
+		// Whether or not the duration is recorded as a trace span, fixed at construction.
+		bool mTrace;
+		// Whether or not hardware events are counted for the stage, fixed at construction.
+		bool mCounters;
+		// Hardware counter values when the scope was entered.
+		PerfCounts mStartCounts;
+		// Whether or not heap use is recorded for the stage, fixed at construction.
+		bool mMemory;
+		// Bytes allocated when the scope was entered.
+		uint64_t mStartAllocated = 0;
+		// Time the scope was entered.
+		std::chrono::steady_clock::time_point mStart;
+
+	public:
+		explicit ScopedStageTimer(Stage stage) :
+			mStage(stage), mStats(StageStatsEnabled()), mTrace(TraceEnabled()),
+			mCounters(mStats && PerfCountersEnabled()),
+			mMemory(mStats && MemoryTrackingEnabled() && AllocationCountingAvailable()) {
+			NoteProgress();
+			if (mMemory) mStartAllocated = GetAllocatedBytes();
+			if (mCounters) mCounters = ReadPerfCounters(mStartCounts);
+			if (mStats || mTrace) mStart = std::chrono::steady_clock::now();
+		}
+		~ScopedStageTimer() { Stop(); }
+		/**
+		* Record the stage before the end of the scope. Later calls, including the one
+		* made when the scope ends, have no effect.
+		*/
+		void Stop() {
+			NoteProgress();
+			if (mStats || mTrace) {
+				auto end = std::chrono::steady_clock::now();
+				PerfCounts endcounts;
+				if (mCounters && ReadPerfCounters(endcounts)) {
+					RecordStageCounters(mStage, endcounts - mStartCounts);
+				}
+				if (mMemory) {
+					RecordStageMemory(mStage, GetAllocatedBytes() - mStartAllocated, GetLiveBytes());
+				}
+				if (mStats) {
+					RecordStageTime(
+						mStage, std::chrono::duration<double, std::micro>(end - mStart).count());
+				}
+				if (mTrace) {
+					RecordTraceSpan(StageToString(mStage), mStart, end);
+				}
+				mStats = false;
+				mTrace = false;
+				mCounters = false;
+				mMemory = false;
+			}
+		}
+		ScopedStageTimer(const ScopedStageTimer&) = delete;
+		ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+	};
+} // namespace textextract
+#endif
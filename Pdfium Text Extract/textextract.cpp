@@ -1,9 +1,23 @@
+#include "checkpoint.h"
+#include "forkedpages.h"
+#include "pagepipeline.h"
 #include "pagerange.h"
+#include "pageresult.h"
 #include "pdfrenderer.h"
+#include "renderbenchmark.h"
+#include "resultring.h"
+#include "slowpagecapture.h"
+#include "stagetimer.h"
+#include "tracewriter.h"
+#include "workersupervisor.h"
 #include "outpututils.h"
 #include "textextractutils.h"
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 #undef snprintf
 #include <boost/program_options.hpp>
@@ -11,21 +25,304 @@
 using namespace textextract;
 namespace po = boost::program_options;
 
-po::options_description GetOptions(bool& textonly) {
+po::options_description GetOptions(
+	bool& textonly, bool& benchmarkprofiles, bool& perfcounters, bool& memorystats, bool& metadata) {
 	po::options_description desc("Options");
 	desc.add_options()
 		("help,h", "Produce help message.")
 		("filepath,f", po::value<std::string>(), "Path to the PDF file to process.")
+		("batch", po::value<std::string>()->default_value(""), "Path to a file listing the PDFs to process, one path per line, in place of filepath.")
+		("checkpoint", po::value<std::string>()->default_value(""), "Path to a checkpoint journal of the pages already written. A run given the same journal, options and output location skips completed documents when the page range also matches, and otherwise skips pages whose output is unchanged.")
+		("checkpointsync", po::value<int>()->default_value(64), "Number of checkpoint records written between syncs to disk.")
+		("jobs", po::value<int>()->default_value(0), "Number of worker processes to extract documents in, so that a crash or hang only restarts its worker. 0 extracts in this process. Stats and traces are not collected from workers. POSIX only: the Windows build ignores it with a warning and extracts in this process.")
+		("pagetimeout", po::value<int>()->default_value(0), "Time in milliseconds a worker or page worker may spend on one page before it is killed and restarted, 0 for no limit. Only used with --jobs or --forkpages, so not on Windows.")
+		("heartbeattimeout", po::value<int>()->default_value(60000), "Time in milliseconds without a heartbeat before a worker is killed and restarted. Workers only send heartbeats while their extraction makes progress, so this also catches a page hung inside pdfium. Progress is noted between pdfium calls, so a single call, such as loading a text layer or drawing one render band, that runs longer than this counts as hung. Only used with --jobs, so not on Windows.")
+		("forkpages", po::value<int>()->default_value(0), "Number of worker processes forked to split the pages of each document between, 0 processes pages in this process. POSIX only: the Windows build ignores it with a warning and processes pages in this process.")
+		("forkmode", po::value<std::string>()->default_value("shared"), "How page workers get the document: shared parses it once before forking so workers share it copy-on-write, independent has each worker parse it, for comparison. Only used with --forkpages, so not on Windows.")
+		("pipeline", po::value<int>()->default_value(0), "Number of threads serializing page results while pdfium extracts the next pages, 0 processes each page in sequence. Queue depths and stage utilization are added to the stats report.")
+		("queuedepth", po::value<int>()->default_value(4), "Number of pages the queues between pipeline stages hold before the stage feeding them waits.")
+		("ringslotmb", po::value<int>()->default_value(16), "Size in MB of each slot of the shared memory ring page workers hand their results to the main process through, so only it writes output. Pages larger than a slot are written by the worker, 0 has workers write every page. Linux only: elsewhere page workers write every page, and on Windows there are no page workers.")
+		("maxpagefailures", po::value<int>()->default_value(2), "Number of times a page may crash or hang a worker before it is quarantined and skipped. Only used with --jobs, so not on Windows.")
+		("memceiling", po::value<int>()->default_value(0), "Memory in MB the workers may use together. When set, --jobs is the most workers, and workers are added while memory and pages per second allow, and stopped before the ceiling or the system's available memory runs out. Workers process one page at a time, --pipeline and --forkpages are ignored. 0 keeps all --jobs workers active. Only used with --jobs, so not on Windows.")
+		("controlinterval", po::value<int>()->default_value(1000), "Time in milliseconds between the memory and throughput samples used with --memceiling. Only used with --jobs, so not on Windows.")
 		("dpi, dpi", po::value<int>()->default_value(300), "Resolution of page render in dots per inch.")
-		("pagerange,p", po::value<std::string>()->default_value("0"), "Range of pages to process, all pages processed by default.")
+		("tileheight", po::value<int>()->default_value(0), "Render pages in horizontal bands of this many pixels, 0 renders each page as a single bitmap.")
+		("renderdir", po::value<std::string>()->default_value(""), "Directory to stream page renders to as PNG files, renders are kept in memory by default.")
+		("rendertimeout", po::value<int>()->default_value(0), "Time limit in milliseconds for rendering a single page, 0 for no limit.")
+		("timeoutaction", po::value<std::string>()->default_value("partial"), "Action when a render exceeds its time limit: partial, lowdpi or skip.")
+		("timeoutdpi", po::value<int>()->default_value(72), "Resolution used to render a page again with the lowdpi timeout action.")
+		("maxpixels", po::value<long long>()->default_value(0), "Largest pixel count of a page render, the dpi is lowered per page to fit. 0 for no limit.")
+		("maxrenderbytes", po::value<long long>()->default_value(0), "Largest bitmap size in bytes of a page render, at four bytes per pixel or one for grayscale profiles. The dpi is lowered per page to fit. 0 for no limit.")
+		("mindpi", po::value<int>()->default_value(0), "Lowest dpi the render budget may lower a page to.")
+		("maxdpi", po::value<int>()->default_value(0), "Highest dpi any page is rendered at, 0 for no limit.")
+		("renderprofile", po::value<std::string>()->default_value("faithful"), "Render profile: faithful, debug or ocr-fast.")
+		("openmode", po::value<std::string>()->default_value("auto"), "Form fill setup when opening the document: auto, full or lean. Auto only sets up forms when the render profile draws them.")
+		("metadata", po::bool_switch(&metadata), "Only write a summary of the page count, and the size, type, rotation and text character count of each page.")
+		("skiptextrender", po::bool_switch(), "Skip rendering pages that have a text layer and no images.")
+		("imagepassthrough", po::bool_switch(), "Write the original JPEG or JPEG 2000 bytes of pages that are nothing but a single embedded image, with no annotations or /Rotate, instead of rendering them. Written to the render directory, or the output location.")
+		("roi", po::value<std::string>()->default_value(""), "Only extract text inside these rectangles, written as [page:]x,y,width,height and separated by semicolons. Rectangles without a page apply to every page.")
+		("roiunits", po::value<std::string>()->default_value("points"), "Units of the roi rectangles, measured from the top left of the page as displayed, after any /Rotate: points or pixels of the render.")
+		("benchmarkprofiles", po::bool_switch(&benchmarkprofiles), "Compare the speed and pixel difference of every render profile over the page range, without writing output.")
+		("stats", po::value<std::string>()->default_value(""), "Path to write a JSON report of per-stage timings to, no timings are taken by default.")
+		("perfcounters", po::bool_switch(&perfcounters), "Add cycles, instructions, cache misses and branch misses per stage to the stats report given with --stats. Linux only.")
+		("memstats", po::bool_switch(&memorystats), "Add per-page resident memory to the stats report, and per-page and per-stage heap use in the Release-MemStats build. Per-page memory is left out with --pipeline, as pages overlap.")
+		("slowpagems", po::value<int>()->default_value(0), "Time in milliseconds after which a page is saved as a standalone PDF to the triage directory, 0 to never save pages.")
+		("triagedir", po::value<std::string>()->default_value(""), "Directory for slow page reproducers and their stage timings, a triage folder in the output location by default.")
+		("report", po::value<std::string>()->default_value(""), "Path to write a JSON report of the status of each page to, listing the pages that were degraded or failed and why.")
+		("trace", po::value<std::string>()->default_value(""), "Path to write a Chrome trace event file of the per-page pipeline to, for viewing in Perfetto.")
+		("pagerange,p", po::value<std::string>()->default_value("0"), "Pages to process, as a comma separated list of pages (negative counting from the end), ranges a-b or a-, first:n, last:n, with an optional /step after a range or all. All pages processed by default.")
 		("outputlocation,o", po::value<std::string>()->default_value(""), "Path to the output directory to write results to.")
 		("TEXT_ONLY", po::bool_switch(&textonly), "Only write text without bounds to file.");
 	return desc;
 }
 
+// Settings of the driver that apply to every document processed.
+struct ExtractSettings {
+	// Output directory given on the command line, empty to write next to each PDF.
+	std::filesystem::path outputLocation;
+	// Page set expression of the pages to process.
+	std::string pageRange;
+	bool textOnly = false;
+	int slowPageMs = 0;
+	// Directory for slow page reproducers, empty for a triage folder in the output location.
+	std::filesystem::path triageDirectory;
+	// Worker processes forked to share the pages of each document, 0 workers for none.
+	ForkedPagesSettings forkedPages{ 0, ForkMode::SHARED, 0 };
+	// Size of each slot of the shared result ring page workers hand pages back through,
+	// 0 to have the workers write their own output.
+	size_t ringSlotBytes = 0;
+	// Threads serializing pages while the next ones are extracted, 0 to process pages in sequence.
+	PipelineSettings pipeline{ 0, 4 };
+};
+
+// Get the directory the results of a document are written to.
+std::filesystem::path GetOutputLocation(const std::filesystem::path& filepath, const ExtractSettings& settings) {
+	return settings.outputLocation.empty() ? filepath.parent_path() : settings.outputLocation;
+}
+
+// Fingerprint everything that decides what a page's output file is called and what it
+// holds, so that the journal only skips a page written with the same options into the
+// same location, under the same name.
+uint64_t GetPageRunKey(const std::filesystem::path& filepath, const RenderOptions& renderoptions,
+	const ExtractSettings& settings) {
+	std::ostringstream key;
+	key << GetOutputLocation(filepath, settings).string() << '|' << filepath.stem().string() << '|' <<
+		settings.textOnly << '|' << renderoptions.dpi << '|' <<
+		renderoptions.tileHeight << '|' << renderoptions.renderDirectory.string() << '|' <<
+		renderoptions.renderTimeoutMs << '|' << static_cast<int>(renderoptions.timeoutAction) << '|' <<
+		renderoptions.timeoutDpi << '|' << renderoptions.maxPixels << '|' << renderoptions.maxRenderBytes << '|' <<
+		renderoptions.minDpi << '|' << renderoptions.maxDpi << '|' << static_cast<int>(renderoptions.profile) << '|' <<
+		static_cast<int>(renderoptions.openMode) << '|' << renderoptions.skipTextOnlyRender << '|' <<
+		renderoptions.imagePassthrough << '|' << static_cast<int>(renderoptions.regionUnit);
+	for (const auto& region : renderoptions.regions) {
+		key << '|' << region.page << ',' << region.x << ',' << region.y << ',' << region.width << ',' << region.height;
+	}
+	return HashString(key.str());
+}
+
+// Fingerprint a whole document's run, which is its pages' fingerprint and the page set,
+// so that the journal only skips a document completed with the same pages.
+uint64_t GetDocumentRunKey(uint64_t pageRunKey, const ExtractSettings& settings) {
+	std::ostringstream key;
+	key << std::hex << pageRunKey << '|' << settings.pageRange;
+	return HashString(key.str());
+}
+
+// Read the PDF paths of a batch list, skipping blank lines and lines starting with #.
+bool ReadBatchList(const std::filesystem::path& batchpath, std::vector<std::filesystem::path>& files) {
+	std::ifstream list(batchpath);
+	if (!list) return false;
+	std::string line;
+	while (std::getline(list, line)) {
+		line.erase(0, line.find_first_not_of(" \t"));
+		line.erase(line.find_last_not_of(" \t\r") + 1);
+		if (line.empty() || line[0] == '#') continue;
+		files.push_back(line);
+	}
+	return true;
+}
+
+// Extract the pages of a document, skipping any work the checkpoint journal already holds,
+// and the pages a previous worker finished or that were quarantined.
+DocumentResult ExtractDocument(const DocumentJob& job, RenderOptions renderoptions,
+	const ExtractSettings& settings, CheckpointJournal* journal, PageProgress* progress) {
+	const std::filesystem::path& filepath = job.path;
+	DocumentResult document;
+	document.fileName = filepath.filename().string();
+	std::string stem = filepath.stem().string();
+	uint64_t documenthash = 0;
+	uint64_t pagerunkey = GetPageRunKey(filepath, renderoptions, settings);
+	uint64_t runkey = GetDocumentRunKey(pagerunkey, settings);
+	if (journal) {
+		// Complete documents are recognised from their contents, without loading them into pdfium.
+		if (!HashFile(filepath, documenthash)) {
+			document.error = "Failed to read the PDF from path.";
+			return document;
+		}
+		if (journal->IsDocumentComplete(documenthash, runkey)) {
+			document.skipped = true;
+			return document;
+		}
+	}
+
+	PdfRenderer pdf(filepath.string());
+	if (!pdf.BufferLoaded()) {
+		document.error = "Failed to load the PDF from path.";
+		return document;
+	}
+	PageRange pages;
+	std::string pageerror;
+	if (!pages.ParsePageRange(settings.pageRange, pdf.GetPageCount(), pageerror)) {
+		document.error = "Invalid page range: " + pageerror;
+		return document;
+	}
+
+	std::filesystem::path outputpath = GetOutputLocation(filepath, settings);
+	std::filesystem::path triagepath = settings.triageDirectory.empty() ?
+		outputpath / "triage" : settings.triageDirectory;
+	renderoptions.renderFilePrefix = stem;
+	renderoptions.imageDirectory = renderoptions.renderDirectory.empty() ?
+		outputpath : renderoptions.renderDirectory;
+
+	BeginDocumentStats(document.fileName);
+	// Process a single page into the current page information.
+	auto processpage = [&](int pagenumber) {
+		int i = pagenumber - 1;
+		SetTracePage(i + 1);
+		ResetPageStageTimes();
+		auto pagestart = std::chrono::steady_clock::now();
+		PageResult pageresult = pdf.GetPageInfo(i, renderoptions);
+		double pagems = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - pagestart).count();
+		// The memory of overlapping pages cannot be told apart, so with a page pipeline
+		// only the per-stage heap use is recorded.
+		if (MemoryTrackingEnabled() && settings.pipeline.serializeThreads == 0) {
+			RecordPageMemory(pagenumber, GetPageRender().total() * GetPageRender().elemSize());
+		}
+		if (settings.slowPageMs > 0 && pagems > settings.slowPageMs) {
+			CaptureSlowPage(pdf, i, pagems, settings.slowPageMs, triagepath, stem);
+		}
+#ifdef _DEBUG
+		DebugTextBoxes(GetPageRender(), GetPageWords());
+#endif // DEBUG
+		return pageresult;
+	};
+	// Serialize the current page information to the contents of its result file.
+	auto serializepage = [&](PageResult& pageresult) {
+		if (pageresult.status == PageStatus::FAILED) return std::string();
+		return SerializeOutput(settings.textOnly);
+	};
+	// Write a serialized page and record it in the journal.
+	auto writepage = [&](PageResult& pageresult, const std::string& contents) {
+		int pagenumber = pageresult.pageNumber;
+		if (pageresult.status != PageStatus::FAILED) {
+			std::cout << "writing output for page: " + std::to_string(pagenumber) << std::endl;
+			if (!WriteOutputFile(GetOutputPath(outputpath, pagenumber, stem, settings.textOnly), contents)) {
+				pageresult.Fail("write_output", "result file could not be written");
+			}
+		}
+		// Failed pages are left out of the journal, so that a restarted run tries them again.
+		if (journal && pageresult.status != PageStatus::FAILED) {
+			journal->RecordPage(documenthash, pagerunkey, pagenumber, GetOutputPath(outputpath, pagenumber, stem, settings.textOnly));
+		}
+		if (pageresult.status != PageStatus::OK) {
+			std::cerr << document.fileName << " page " << pageresult.pageNumber << " " <<
+				PageStatusToString(pageresult.status) << ":";
+			for (const auto& reason : pageresult.reasons) std::cerr << " " << reason << ";";
+			std::cerr << std::endl;
+		}
+	};
+	// Write the output of the current page information and clear it.
+	auto finishpage = [&](PageResult& pageresult) {
+		std::string contents = serializepage(pageresult);
+		ClearPageInfo();
+		writepage(pageresult, contents);
+	};
+
+	std::vector<int> pendingpages;
+	for (int pagenumber : pages.pages) {
+		if (job.completedPages.count(pagenumber)) continue;
+		if (job.quarantinedPages.count(pagenumber)) {
+			PageResult quarantined;
+			quarantined.pageNumber = pagenumber;
+			quarantined.Fail("quarantine", "page crashed or hung a worker too many times");
+			if (progress) progress->PageFinished(quarantined);
+			document.pages.push_back(quarantined);
+			continue;
+		}
+		if (journal && journal->IsPageComplete(documenthash, pagerunkey, pagenumber,
+			GetOutputPath(outputpath, pagenumber, stem, settings.textOnly))) {
+			document.pagesSkipped++;
+			continue;
+		}
+		pendingpages.push_back(pagenumber);
+	}
+
+	std::vector<PageResult> forkedresults;
+	ForkedPagesReport forkreport;
+	auto preparedocument = [&]() {
+		std::string error;
+		return pdf.PrepareDocument(renderoptions, error);
+	};
+	// Two slots per worker, so that a worker can publish its next page while the parent writes the last.
+	ResultRing ring;
+	bool forking = settings.forkedPages.workers > 0 && pendingpages.size() > 1;
+	if (forking && settings.ringSlotBytes > 0) ring.Create(settings.forkedPages.workers * 2, settings.ringSlotBytes);
+	if (forking && RunForkedPages(pendingpages, settings.forkedPages, preparedocument,
+		processpage, finishpage, &ring, progress, forkedresults, forkreport)) {
+		document.pages.insert(document.pages.end(), forkedresults.begin(), forkedresults.end());
+		document.pageWorkers = ForkedPagesReportToJson(forkreport);
+		std::cout << "Page workers ready after " << forkreport.startupMs << "ms, total PSS " <<
+			forkreport.totalPssBytes / (1024 * 1024) << "MB." << std::endl;
+		// The workers appended to the journal without syncing it.
+		if (journal) journal->Sync(true);
+	}
+	else if (settings.pipeline.serializeThreads > 0 && pendingpages.size() > 1) {
+		// Pages are serialized and written while pdfium extracts the next ones.
+		std::vector<PageResult> pipelineresults;
+		PipelineReport pipelinereport;
+		RunPagePipeline(pendingpages, settings.pipeline,
+			[&](int pagenumber) {
+				if (progress) progress->PageStarted(pagenumber);
+				return processpage(pagenumber);
+			},
+			serializepage,
+			[&](PageResult& pageresult, const std::string& contents) {
+				writepage(pageresult, contents);
+				if (progress) progress->PageFinished(pageresult);
+			},
+			pipelineresults, pipelinereport);
+		document.pages.insert(document.pages.end(), pipelineresults.begin(), pipelineresults.end());
+		RecordDocumentPipeline(PipelineReportToJson(pipelinereport));
+	}
+	else {
+		// A page that fails is recorded and skipped, so that the rest of the document is still processed.
+		for (int pagenumber : pendingpages) {
+			if (progress) progress->PageStarted(pagenumber);
+			PageResult pageresult = processpage(pagenumber);
+			finishpage(pageresult);
+			if (progress) progress->PageFinished(pageresult);
+			document.pages.push_back(pageresult);
+		}
+	}
+	std::sort(document.pages.begin(), document.pages.end(),
+		[](const PageResult& a, const PageResult& b) { return a.pageNumber < b.pageNumber; });
+	EndDocumentStats();
+	// Pages that failed in an earlier worker on this document count as well, although
+	// only the pages processed here are in the result.
+	if (journal && !document.AnyFailed() && job.failedPages.empty()) {
+		journal->RecordDocument(documenthash, runkey);
+	}
+	return document;
+}
+
 int main(int argc, char* argv[]) {
 	bool textonly = false;
-	auto desc = GetOptions(textonly);
+	bool benchmarkprofiles = false;
+	bool perfcounters = false;
+	bool memorystats = false;
+	bool metadata = false;
+	auto desc = GetOptions(textonly, benchmarkprofiles, perfcounters, memorystats, metadata);
 	po::variables_map vm;
 	po::store(po::parse_command_line(argc, argv, desc), vm);
 	po::notify(vm);
@@ -35,24 +332,192 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
-	std::filesystem::path filepath(vm["filepath"].as<std::string>());
-	std::filesystem::path outputpath = vm["outputlocation"].as<std::string>() == "" ?
-		filepath.parent_path() : vm["outputlocation"].as<std::string>();
-	
-	PdfRenderer pdf(filepath.string());
-	if (!pdf.BufferLoaded()) {
-		std::cerr << "Failed to load the PDF from path." << std::endl;
+	std::string batchpath = vm["batch"].as<std::string>();
+	std::vector<std::filesystem::path> files;
+	if (!batchpath.empty()) {
+		if (metadata || benchmarkprofiles) {
+			std::cerr << "The metadata and benchmarkprofiles modes take a single filepath, not a batch." << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		if (!ReadBatchList(batchpath, files)) {
+			std::cerr << "Failed to read the batch list: " << batchpath << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+	else if (vm.count("filepath")) {
+		files.push_back(vm["filepath"].as<std::string>());
+	}
+	else {
+		std::cerr << "Either a filepath or a batch list is required." << std::endl;
 		exit(EXIT_FAILURE);
 	}
 
-	PageRange pages(vm["pagerange"].as<std::string>(), pdf.GetPageCount());
-	for (int i = pages.firstpage - 1; i < pages.lastpage; i++) {
-		pdf.GetPageInfo(i, vm["dpi"].as<int>());
-#ifdef _DEBUG
-		DebugTextBoxes(GetPageRender(), GetPageWords());
-#endif // DEBUG
-		WriteOutput(outputpath, i + 1, filepath.stem().string(), textonly);
-		ClearPageInfo();
+	ExtractSettings settings;
+	settings.outputLocation = vm["outputlocation"].as<std::string>();
+	settings.pageRange = vm["pagerange"].as<std::string>();
+	settings.textOnly = textonly;
+	settings.slowPageMs = vm["slowpagems"].as<int>();
+	settings.triageDirectory = vm["triagedir"].as<std::string>();
+	settings.forkedPages.workers = vm["forkpages"].as<int>();
+	settings.forkedPages.pageTimeoutMs = vm["pagetimeout"].as<int>();
+	settings.pipeline.serializeThreads = std::max(vm["pipeline"].as<int>(), 0);
+	settings.pipeline.queueDepth = std::max(vm["queuedepth"].as<int>(), 1);
+	settings.ringSlotBytes = static_cast<size_t>(std::max(vm["ringslotmb"].as<int>(), 0)) * 1024 * 1024;
+	if (!ParseForkMode(vm["forkmode"].as<std::string>(), settings.forkedPages.mode)) {
+		std::cerr << "Invalid fork mode: " << vm["forkmode"].as<std::string>() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if (metadata) {
+		std::filesystem::path filepath = files.front();
+		PdfRenderer pdf(filepath.string());
+		DocumentMetadata documentmetadata;
+		if (!pdf.BufferLoaded()) {
+			std::cerr << "Failed to load the PDF from path." << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		if (!pdf.GetDocumentMetadata(documentmetadata)) {
+			std::cerr << "Failed to load the PDF for its metadata." << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		std::filesystem::path metadatapath =
+			GetOutputLocation(filepath, settings) / (filepath.stem().string() + "metadata.json");
+		return WriteDocumentMetadata(metadatapath, filepath.filename().string(), documentmetadata) ?
+			0 : EXIT_FAILURE;
+	}
+
+	RenderOptions renderoptions;
+	renderoptions.dpi = vm["dpi"].as<int>();
+	renderoptions.tileHeight = vm["tileheight"].as<int>();
+	renderoptions.renderDirectory = vm["renderdir"].as<std::string>();
+	renderoptions.renderTimeoutMs = vm["rendertimeout"].as<int>();
+	renderoptions.timeoutDpi = vm["timeoutdpi"].as<int>();
+	renderoptions.maxPixels = vm["maxpixels"].as<long long>();
+	renderoptions.maxRenderBytes = vm["maxrenderbytes"].as<long long>();
+	renderoptions.minDpi = vm["mindpi"].as<int>();
+	renderoptions.maxDpi = vm["maxdpi"].as<int>();
+	renderoptions.skipTextOnlyRender = vm["skiptextrender"].as<bool>();
+	renderoptions.imagePassthrough = vm["imagepassthrough"].as<bool>();
+	if (!ParseRenderProfile(vm["renderprofile"].as<std::string>(), renderoptions.profile)) {
+		std::cerr << "Invalid render profile: " << vm["renderprofile"].as<std::string>() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (!ParseDocumentOpenMode(vm["openmode"].as<std::string>(), renderoptions.openMode)) {
+		std::cerr << "Invalid open mode: " << vm["openmode"].as<std::string>() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (!vm["roi"].as<std::string>().empty() &&
+		!ParseRegions(vm["roi"].as<std::string>(), renderoptions.regions)) {
+		std::cerr << "Invalid regions of interest: " << vm["roi"].as<std::string>() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (!ParseRegionUnit(vm["roiunits"].as<std::string>(), renderoptions.regionUnit)) {
+		std::cerr << "Invalid region units: " << vm["roiunits"].as<std::string>() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (!ParseRenderTimeoutAction(vm["timeoutaction"].as<std::string>(), renderoptions.timeoutAction)) {
+		std::cerr << "Invalid timeout action: " << vm["timeoutaction"].as<std::string>() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	std::string statspath = vm["stats"].as<std::string>();
+	// Slow page capture needs the stage timings of each page, even without a stats report.
+	EnableStageStats(!statspath.empty() || settings.slowPageMs > 0);
+	if (perfcounters && statspath.empty()) {
+		std::cerr << "--perfcounters adds to the stats report, and needs --stats." << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (perfcounters) {
+		// Stats are still written without counters if they cannot be opened.
+		EnablePerfCounters();
+	}
+	EnableMemoryTracking(memorystats && !statspath.empty());
+	if (MemoryTrackingEnabled() && !AllocationCountingAvailable()) {
+		std::cerr << "This build does not count heap allocations, --memstats only reports resident memory. Build the Release-MemStats configuration to count them." << std::endl;
+	}
+	std::string tracepath = vm["trace"].as<std::string>();
+	EnableTrace(!tracepath.empty());
+
+	if (benchmarkprofiles) {
+		PdfRenderer pdf(files.front().string());
+		PageRange pages;
+		std::string pageerror;
+		if (!pdf.BufferLoaded() ||
+			!pages.ParsePageRange(settings.pageRange, pdf.GetPageCount(), pageerror)) {
+			std::cerr << "Failed to load the PDF for benchmarking. " << pageerror << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		renderoptions.renderFilePrefix = files.front().stem().string();
+		PrintRenderProfileResults(
+			BenchmarkRenderProfiles(pdf, pages.pages, renderoptions), std::cout);
+		return 0;
+	}
+
+	std::unique_ptr<CheckpointJournal> journal;
+	std::string checkpointpath = vm["checkpoint"].as<std::string>();
+	if (!checkpointpath.empty()) {
+		journal = std::make_unique<CheckpointJournal>();
+		if (!journal->Open(checkpointpath, vm["checkpointsync"].as<int>())) exit(EXIT_FAILURE);
+	}
+
+	std::vector<DocumentResult> documents;
+	nlohmann::json supervisorjson;
+	SupervisorSettings supervisorsettings;
+	supervisorsettings.jobs = vm["jobs"].as<int>();
+	supervisorsettings.pageTimeoutMs = vm["pagetimeout"].as<int>();
+	supervisorsettings.heartbeatTimeoutMs = vm["heartbeattimeout"].as<int>();
+	supervisorsettings.maxPageFailures = vm["maxpagefailures"].as<int>();
+	supervisorsettings.memoryCeilingBytes = static_cast<uint64_t>(std::max(vm["memceiling"].as<int>(), 0)) * 1024 * 1024;
+	supervisorsettings.controlIntervalMs = std::max(vm["controlinterval"].as<int>(), 10);
+	SupervisorReport supervisorreport;
+	// The controller bounds the pages in flight through the active workers, which only
+	// holds while each worker has a single page at a time.
+	if (supervisorsettings.jobs > 0 && supervisorsettings.memoryCeilingBytes > 0 &&
+		(settings.pipeline.serializeThreads > 0 || settings.forkedPages.workers > 0)) {
+		std::cerr << "--pipeline and --forkpages are ignored with --memceiling, workers process one page at a time." << std::endl;
+		settings.pipeline.serializeThreads = 0;
+		settings.forkedPages.workers = 0;
+	}
+	// Workers sync the journal after each document, as they exit without unwinding.
+	JobRunner runner = [&](const DocumentJob& job, PageProgress* progress) {
+		DocumentResult document = ExtractDocument(job, renderoptions, settings, journal.get(), progress);
+		if (journal) journal->Sync();
+		return document;
+	};
+	if (supervisorsettings.jobs > 0 &&
+		RunSupervised(files, supervisorsettings, runner, documents, supervisorreport)) {
+		supervisorjson = SupervisorReportToJson(supervisorreport);
+		std::cerr << "Workers restarted " << supervisorreport.restarts << " times, " <<
+			supervisorreport.quarantine.size() << " pages quarantined." << std::endl;
+		for (const auto& page : supervisorreport.quarantine) {
+			std::cerr << "Quarantined " << page.fileName << " page " << page.pageNumber << std::endl;
+		}
+	}
+	else {
+		for (size_t i = 0; i < files.size(); i++) {
+			DocumentJob job;
+			job.index = i;
+			job.path = files[i];
+			documents.push_back(runner(job, nullptr));
+		}
 	}
-	return 0;
-}
\ No newline at end of file
+	for (const auto& document : documents) {
+		if (!document.error.empty()) {
+			std::cerr << document.fileName << ": " << document.error << std::endl;
+		}
+	}
+
+	if (!statspath.empty()) {
+		WriteStageStats(statspath);
+	}
+	if (!tracepath.empty()) {
+		WriteTrace(tracepath);
+	}
+	std::string reportpath = vm["report"].as<std::string>();
+	if (!reportpath.empty()) {
+		WritePageReport(reportpath, documents, supervisorjson);
+	}
+	bool anyfailed = std::any_of(documents.begin(), documents.end(),
+		[](const DocumentResult& document) { return document.AnyFailed(); });
+	return anyfailed ? EXIT_FAILURE : 0;
+}
@@ -1,6 +1,9 @@
 #include "textextractutils.h"
 
 #include "load_support.h"
+#include "stagetimer.h"
+
+#include <algorithm>
 
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -45,6 +48,7 @@ namespace textextract {
 	}
 
 	void RemoveWaterMarkText(std::vector<TextBox>& textBoxes) {
+		ScopedStageTimer timer(Stage::WATERMARK_FILTER);
 		double meanarea = AverageRectArea(textBoxes);
 		double stddev = RectAreaStdDev(textBoxes, meanarea);
 		double anomalycutoff = stddev * 3;
@@ -52,6 +56,8 @@ namespace textextract {
 		double upperlimit = meanarea + anomalycutoff;
 		std::vector<TextBox> correctedtextboxes;
 		for (auto it = textBoxes.begin(); it != textBoxes.end(); ) {
+			// Each box is checked against every other, which takes a while on a dense page.
+			NoteProgress();
 			if (it->GetBounds().area() > upperlimit || it->GetBounds().area() < lowerlimit) {
 				if (BoundsOverlaps(*it, textBoxes, std::distance(textBoxes.begin(), it))) {
 					it = textBoxes.erase(it);
@@ -113,6 +119,7 @@ namespace textextract {
 	}
 
 	std::vector<std::wstring> GetWordTokens(std::wstring rawText) {
+		ScopedStageTimer timer(Stage::TOKENIZE);
 		std::vector<std::wstring> wordtokens;
 		std::wstring processedpagetext = CleanText(rawText);
 	
@@ -172,9 +179,12 @@ namespace textextract {
 	std::vector<TextBox> GetTextBoxesFromTokens(
 		const std::vector<std::wstring>& wordTokens, const FPDF_TEXTPAGE textPage,
 		const int pageWidth, const int pageHeight) {
+		ScopedStageTimer timer(Stage::BOX_MATCH);
 		std::vector<int> usedindexes;
 		std::vector<TextBox> tokentextboxes;
 		for (const auto& token : wordTokens) {
+			// Each token is a search of the page, which takes a while on a dense page.
+			NoteProgress();
 			std::unique_ptr<unsigned short, pdfium::FreeDeleter> searchtoken = 
 				GetFPDFWideString(token);
 			FPDF_SCHHANDLE search =
@@ -222,7 +232,153 @@ namespace textextract {
 		return tokentextboxes;
 	}
 
+	std::wstring GetTextInRegions(const FPDF_TEXTPAGE textPage, const std::vector<FS_RECTF>& regions) {
+		ScopedStageTimer timer(Stage::RAW_TEXT);
+		std::wstring regiontext;
+		for (const auto& region : regions) {
+			int length = FPDFText_GetBoundedText(
+				textPage, region.left, region.top, region.right, region.bottom, nullptr, 0);
+			if (length <= 0) continue;
+			std::vector<unsigned short> buffer(length + 1);
+			FPDFText_GetBoundedText(
+				textPage, region.left, region.top, region.right, region.bottom, buffer.data(), length);
+			if (!regiontext.empty()) regiontext += L'\n';
+			regiontext += GetPlatformWString(buffer.data());
+		}
+		return regiontext;
+	}
+
+	// Determine if a point in PDF page coordinates is inside any of the regions.
+	bool InRegions(double x, double y, const std::vector<FS_RECTF>& regions) {
+		for (const auto& region : regions) {
+			if (x >= region.left && x <= region.right && y >= region.bottom && y <= region.top) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Most line segments that can overlap the regions before the page is walked in full instead. Locating a
+	// segment's characters costs pdfium a pass over the page, so this only pays off for small regions.
+	constexpr int MAX_REGION_SEGMENTS = 32;
+
+	bool IsLineBreak(unsigned int unicode) {
+		return unicode == L'\n' || unicode == L'\r';
+	}
+
+	// Determine the character index ranges of the lines of text that cross the regions, so that only those
+	// need to be walked. Each line segment overlapping a region is located with FPDFText_GetCharIndexAtPos
+	// and widened to its whole line. Returns false if the lines could not be located this way.
+	bool GetRegionLineRanges(const FPDF_TEXTPAGE textPage, const std::vector<FS_RECTF>& regions, int charCount,
+		std::vector<std::pair<int, int>>& ranges) {
+		int segments = 0;
+		int rectcount = FPDFText_CountRects(textPage, 0, -1);
+		for (int r = 0; r < rectcount; r++) {
+			double left = 0, top = 0, right = 0, bottom = 0;
+			if (!FPDFText_GetRect(textPage, r, &left, &top, &right, &bottom)) return false;
+			for (const auto& region : regions) {
+				double overlapleft = std::max(left, static_cast<double>(region.left));
+				double overlapright = std::min(right, static_cast<double>(region.right));
+				double overlapbottom = std::max(bottom, static_cast<double>(region.bottom));
+				double overlaptop = std::min(top, static_cast<double>(region.top));
+				if (overlapleft > overlapright || overlapbottom > overlaptop) continue;
+				if (++segments > MAX_REGION_SEGMENTS) return false;
+
+				int index = FPDFText_GetCharIndexAtPos(textPage, (overlapleft + overlapright) / 2,
+					(overlapbottom + overlaptop) / 2, (overlapright - overlapleft) / 2 + 1, (overlaptop - overlapbottom) / 2 + 1);
+				double charleft = 0, charright = 0, charbottom = 0, chartop = 0;
+				if (index < 0 || !FPDFText_GetCharBox(textPage, index, &charleft, &charright, &charbottom, &chartop)) return false;
+				// The character found must belong to this segment, not to an overlapping line.
+				double x = (charleft + charright) / 2, y = (charbottom + chartop) / 2;
+				if (x < left - 1 || x > right + 1 || y < bottom - 1 || y > top + 1) return false;
+
+				bool covered = std::any_of(ranges.begin(), ranges.end(),
+					[index](const std::pair<int, int>& range) { return index >= range.first && index < range.second; });
+				if (!covered) {
+					int start = index, end = index + 1;
+					while (start > 0 && !IsLineBreak(FPDFText_GetUnicode(textPage, start - 1))) start--;
+					while (end < charCount && !IsLineBreak(FPDFText_GetUnicode(textPage, end))) end++;
+					ranges.emplace_back(start, end);
+				}
+				break;
+			}
+		}
+		std::sort(ranges.begin(), ranges.end());
+		return true;
+	}
+
+	void VisitTextBoxes(const FPDF_TEXTPAGE textPage, const std::vector<FS_RECTF>& regions,
+		const int pageWidth, const int pageHeight, const std::function<void(const TextBox& word)>& onWord,
+		const std::function<void()>& onLineEnd) {
+		std::wstring word;
+		cv::Rect combinedrect;
+		int angle = 0;
+		bool lineopen = false;
+		auto endword = [&]() {
+			CleanToken(word);
+			if (!word.empty()) {
+				onWord(TextBox(NormalizeRect(combinedrect, angle, pageWidth, pageHeight), word));
+				lineopen = true;
+			}
+			word.clear();
+			combinedrect = cv::Rect();
+		};
+		auto endline = [&]() {
+			if (!word.empty()) endword();
+			if (lineopen && onLineEnd) onLineEnd();
+			lineopen = false;
+		};
+		auto visitchars = [&](int start, int end) {
+			for (int i = start; i < end; i++) {
+				double left = 0, top = 0, right = 0, bottom = 0;
+				unsigned int unicode = FPDFText_GetUnicode(textPage, i);
+				if (IsLineBreak(unicode)) {
+					// pdfium marks the end of each line of text with a line break.
+					endline();
+					continue;
+				}
+				if (iswspace(unicode) || !FPDFText_GetCharBox(textPage, i, &left, &right, &bottom, &top) ||
+					(!regions.empty() && !InRegions((left + right) / 2, (top + bottom) / 2, regions))) {
+					if (!word.empty()) endword();
+					continue;
+				}
+				if (word.empty()) {
+					// We assume angle will be the same for all char boxes of a word
+					angle = FPDFText_GetCharAngle(textPage, i) * (180.0 / 3.141592653589793238463);
+				}
+				cv::Rect charrect(cv::Point(left, top), cv::Point(right, bottom));
+				if (charrect.width == 0 && charrect.height != 0) charrect.width = 1;
+				else if (charrect.width != 0 && charrect.height == 0) charrect.height = 1;
+				combinedrect |= charrect;
+				word += static_cast<wchar_t>(unicode);
+			}
+		};
+
+		int charcount = FPDFText_CountChars(textPage);
+		std::vector<std::pair<int, int>> ranges;
+		if (!regions.empty() && GetRegionLineRanges(textPage, regions, charcount, ranges)) {
+			// Only the lines crossing the regions can hold words inside them.
+			for (const auto& range : ranges) {
+				visitchars(range.first, range.second);
+				endline();
+			}
+			return;
+		}
+		visitchars(0, charcount);
+		endline();
+	}
+
+	std::vector<TextBox> GetTextBoxesInRegions(const FPDF_TEXTPAGE textPage, const std::vector<FS_RECTF>& regions,
+		const int pageWidth, const int pageHeight) {
+		ScopedStageTimer timer(Stage::BOX_MATCH);
+		std::vector<TextBox> regiontextboxes;
+		VisitTextBoxes(textPage, regions, pageWidth, pageHeight,
+			[&](const TextBox& word) { regiontextboxes.push_back(word); }, nullptr);
+		return regiontextboxes;
+	}
+
 	void RescaleTextBoxes(std::vector<TextBox>& textBoxes, const PageDimensions& originalDims, const PageDimensions& renderDims) {
+		ScopedStageTimer timer(Stage::RESCALE);
 		for (auto& tb : textBoxes) {
 			tb.RescaleDims(originalDims, renderDims);
 		}
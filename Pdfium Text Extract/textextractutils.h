@@ -1,6 +1,8 @@
 #ifndef TEXT_EXTRACT_UTILS
 #define TEXT_EXTRACT_UTILS
 
+#include <functional>
+
 #include "pdfium/cpp/fpdf_scopers.h"
 
 #include "textbox.h"
@@ -50,5 +52,44 @@ namespace textextract {
 	*/
 	std::vector<TextBox> GetTextBoxesFromTokens(const std::vector<std::wstring>& wordTokens, const FPDF_TEXTPAGE textPage,
 		const int pageWidth, const int pageHeight);
+	/**
+	* Get the text inside a set of regions of a page, one line per region.
+	*
+	* @param textPage FPDF_TEXTPAGE to get the text from.
+	* @param regions Rectangles in PDF page coordinates to get the text inside of.
+	*
+	* @returns The text of the regions as a wstring.
+	*/
+	std::wstring GetTextInRegions(const FPDF_TEXTPAGE textPage, const std::vector<FS_RECTF>& regions);
+	/**
+	* Build words with their bounds from the characters whose boxes are centered inside a
+	* set of regions. Words are split on whitespace and at region edges, and cleaned the
+	* same way as word tokens. No text search is done, so the cost follows the number of
+	* characters in the regions rather than the number of words on the page.
+	*
+	* @param textPage FPDF_TEXTPAGE that the characters are taken from.
+	* @param regions Rectangles in PDF page coordinates to take characters from.
+	* @param pageWidth width of the page.
+	* @param pageHeight height of the page.
+	*
+	* @returns vector of TextBoxes for the words in the regions.
+	*/
+	std::vector<TextBox> GetTextBoxesInRegions(const FPDF_TEXTPAGE textPage, const std::vector<FS_RECTF>& regions,
+		const int pageWidth, const int pageHeight);
+	/**
+	* Build words with their bounds from the characters of a page in text layer order,
+	* passing each word on as soon as it ends, so that the words of a page are never held
+	* together. Words are split and cleaned as in GetTextBoxesInRegions.
+	*
+	* @param textPage FPDF_TEXTPAGE that the characters are taken from.
+	* @param regions Rectangles in PDF page coordinates to take characters from, empty for the whole page.
+	* @param pageWidth width of the page.
+	* @param pageHeight height of the page.
+	* @param onWord Called with each word.
+	* @param onLineEnd Called after the last word of each line of the text layer, may be empty.
+	*/
+	void VisitTextBoxes(const FPDF_TEXTPAGE textPage, const std::vector<FS_RECTF>& regions,
+		const int pageWidth, const int pageHeight, const std::function<void(const TextBox& word)>& onWord,
+		const std::function<void()>& onLineEnd);
 } // namespace textextract
 #endif
\ No newline at end of file
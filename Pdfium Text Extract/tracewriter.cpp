@@ -0,0 +1,117 @@
+#include "tracewriter.h"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace textextract {
+	namespace {
+		// A span recorded by ScopedStageTimer, timestamps are in microseconds since
+		// tracing was enabled.
+		struct TraceSpan {
+			const char* name;
+			double start;
+			double duration;
+			int page;
+		};
+
+		// Spans recorded by a single thread.
+		struct TraceBuffer {
+			int threadId = 0;
+			int page = 0;
+			std::vector<TraceSpan> spans;
+		};
+
+		bool mEnabled = false;
+		std::chrono::steady_clock::time_point mTraceStart;
+		// Guards registration of new thread buffers, not the buffers themselves.
+		std::mutex mBuffersMutex;
+		std::vector<std::unique_ptr<TraceBuffer>> mBuffers;
+
+		// Get the buffer of the calling thread, registering it on first use.
+		TraceBuffer& ThreadBuffer() {
+			thread_local TraceBuffer* buffer = nullptr;
+			if (!buffer) {
+				std::lock_guard<std::mutex> lock(mBuffersMutex);
+				mBuffers.push_back(std::make_unique<TraceBuffer>());
+				buffer = mBuffers.back().get();
+				buffer->threadId = static_cast<int>(mBuffers.size());
+			}
+			return *buffer;
+		}
+	} // namespace
+
+	void EnableTrace(bool enabled) {
+		mTraceStart = std::chrono::steady_clock::now();
+		mEnabled = enabled;
+	}
+
+	bool TraceEnabled() {
+		return mEnabled;
+	}
+
+	void SetTracePage(int pageNumber) {
+		if (mEnabled) ThreadBuffer().page = pageNumber;
+	}
+
+	void RecordTraceSpan(
+		const char* name, std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end) {
+		TraceBuffer& buffer = ThreadBuffer();
+		TraceSpan span;
+		span.name = name;
+		span.start = std::chrono::duration<double, std::micro>(start - mTraceStart).count();
+		span.duration = std::chrono::duration<double, std::micro>(end - start).count();
+		span.page = buffer.page;
+		buffer.spans.push_back(span);
+	}
+
+	bool WriteTrace(const std::filesystem::path& tracePath) {
+		std::lock_guard<std::mutex> lock(mBuffersMutex);
+		const int pid = static_cast<int>(getpid());
+		nlohmann::json events = nlohmann::json::array();
+		for (const auto& buffer : mBuffers) {
+			nlohmann::json threadname;
+			threadname["ph"] = "M";
+			threadname["name"] = "thread_name";
+			threadname["pid"] = pid;
+			threadname["tid"] = buffer->threadId;
+			threadname["args"] = { {"name", "worker " + std::to_string(buffer->threadId)} };
+			events.push_back(threadname);
+			for (const auto& span : buffer->spans) {
+				nlohmann::json event;
+				event["ph"] = "X";
+				event["name"] = span.name;
+				event["cat"] = "page";
+				event["ts"] = span.start;
+				event["dur"] = span.duration;
+				event["pid"] = pid;
+				event["tid"] = buffer->threadId;
+				if (span.page > 0) event["args"] = { {"page", span.page} };
+				events.push_back(event);
+			}
+		}
+		nlohmann::json trace;
+		trace["traceEvents"] = events;
+		trace["displayTimeUnit"] = "ms";
+		std::ofstream file(tracePath);
+		if (!file.is_open()) {
+			std::cerr << "Error opening the trace file: " << tracePath.string() << std::endl;
+			return false;
+		}
+		file << trace.dump();
+		return true;
+	}
+} // namespace textextract
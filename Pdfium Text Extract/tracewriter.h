@@ -0,0 +1,48 @@
+#ifndef TRACE_WRITER
+#define TRACE_WRITER
+
+#include <chrono>
+#include <filesystem>
+
+namespace textextract {
+	/**
+	* Turn trace event collection on or off. Event timestamps are measured from the
+	* moment tracing is enabled.
+	*
+	* @param enabled True to collect trace events.
+	*/
+	void EnableTrace(bool enabled);
+	/**
+	* Determine if trace events are being collected.
+	*
+	* @returns True if tracing is enabled.
+	*/
+	bool TraceEnabled();
+	/**
+	* Set the page that spans recorded on the calling thread belong to.
+	*
+	* @param pageNumber Page number attached to subsequent spans, 0 for none.
+	*/
+	void SetTracePage(int pageNumber);
+	/**
+	* Record a completed span on the calling thread. Each thread appends to its own
+	* buffer, so recording does not take a lock once the thread has recorded a span.
+	*
+	* @param name Name of the span, must outlive the trace.
+	* @param start Time the span began.
+	* @param end Time the span ended.
+	*/
+	void RecordTraceSpan(
+		const char* name, std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end);
+	/**
+	* Write every recorded span as a Chrome trace event JSON file, which can be loaded in
+	* Perfetto or chrome://tracing. Threads that record spans must have finished.
+	*
+	* @param tracePath Path of the trace file to write.
+	*
+	* @returns True if the file was written.
+	*/
+	bool WriteTrace(const std::filesystem::path& tracePath);
+} // namespace textextract
+#endif
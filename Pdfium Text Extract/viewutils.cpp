@@ -25,6 +25,35 @@ namespace textextract {
 	  PageSize(PageType::ISO_A8, PageDimensions(148, 210)),
 	};
 
+	// Names of the page types, in the order of PageType.
+	static const char* pageTypeNames[] = {
+	  "none", "letter", "legal", "ledger", "tabloid", "executive", "ansi-c", "ansi-d", "ansi-e",
+	  "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "a8",
+	};
+
+	PageDimensions GetPageTypeDimensions(PageType pageType) {
+		for (const auto& pagesize : pageSizeTable) {
+			if (pagesize.GetType() == pageType) return pagesize.GetPageDimensions();
+		}
+		return pageSizeTable[0].GetPageDimensions();
+	}
+
+	const char* PageTypeToString(PageType pageType) {
+		int index = static_cast<int>(pageType);
+		if (index < 0 || index >= (sizeof(pageTypeNames) / sizeof(pageTypeNames[0]))) return pageTypeNames[0];
+		return pageTypeNames[index];
+	}
+
+	bool ParsePageType(const std::string& name, PageType& pageType) {
+		for (int i = 1; i < (sizeof(pageTypeNames) / sizeof(pageTypeNames[0])); i++) {
+			if (name == pageTypeNames[i]) {
+				pageType = static_cast<PageType>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
 	void PageSize::DeterminePageSize(int width, int height) {
 		PageDimensions pageDim(width, height);
 		mPageDimensions = pageDim;
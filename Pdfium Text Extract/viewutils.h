@@ -1,6 +1,8 @@
 #ifndef VIEW_UTILS
 #define VIEW_UTILS
 
+#include <string>
+
 namespace textextract {
 	enum class PageOrientation { NONE = 0, PORTRAIT = 1, LANDSCAPE = 2 };
 
@@ -46,6 +48,32 @@ namespace textextract {
 		PageDimensions(int w, int h) : width(w), height(h) {}
 	};
 
+	/**
+	* Get the standard dimensions of a page type.
+	*
+	* @param pageType The page type to get dimensions for.
+	*
+	* @returns The dimensions of the page type, in points.
+	*/
+	PageDimensions GetPageTypeDimensions(PageType pageType);
+	/**
+	* Get the name of a page type, as accepted by ParsePageType.
+	*
+	* @param pageType The page type to name.
+	*
+	* @returns The name of the page type.
+	*/
+	const char* PageTypeToString(PageType pageType);
+	/**
+	* Parse a page type from its name, such as letter, legal or a4.
+	*
+	* @param name Name of the page type.
+	* @param pageType Set to the parsed page type.
+	*
+	* @returns True if the name is a known page type.
+	*/
+	bool ParsePageType(const std::string& name, PageType& pageType);
+
 	/**
 	* @brief Class that describes the size of a page, in terms of dimensions and page type.
 	*/
@@ -0,0 +1,112 @@
+#include "workerpipe.h"
+
+#include <sstream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace textextract {
+	namespace {
+		// Separates the reasons of a page result in a message.
+		const char REASON_SEPARATOR = '\x1f';
+	} // namespace
+
+	std::string EncodePageResult(const PageResult& result) {
+		std::string reasons;
+		for (const auto& reason : result.reasons) {
+			if (!reasons.empty()) reasons += REASON_SEPARATOR;
+			// Reasons must stay on the message line.
+			for (char c : reason) reasons += (c == '\n' || c == '\r') ? ' ' : c;
+		}
+		return std::to_string(result.pageNumber) + " " +
+			std::to_string(static_cast<int>(result.status)) + " " + reasons;
+	}
+
+	bool DecodePageResult(const std::string& fields, PageResult& result) {
+		std::istringstream stream(fields);
+		int status = 0;
+		if (!(stream >> result.pageNumber >> status)) return false;
+		result.status = static_cast<PageStatus>(status);
+		result.reasons.clear();
+		std::string reasons;
+		std::getline(stream >> std::ws, reasons);
+		std::istringstream reasonstream(reasons);
+		std::string reason;
+		while (std::getline(reasonstream, reason, REASON_SEPARATOR)) {
+			if (!reason.empty()) result.reasons.push_back(reason);
+		}
+		return true;
+	}
+
+	void PipeProgress::PageStarted(int pageNumber) {
+		WritePipeLine(mFd, "S " + std::to_string(pageNumber));
+	}
+
+	void PipeProgress::PageFinished(const PageResult& result) {
+		WritePipeLine(mFd, "E " + EncodePageResult(result));
+	}
+
+#ifndef _WIN32
+	bool WritePipeLine(int fd, const std::string& line) {
+		std::string message = line + "\n";
+		const char* data = message.data();
+		size_t remaining = message.size();
+		while (remaining > 0) {
+			ssize_t written = write(fd, data, remaining);
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				return false;
+			}
+			data += written;
+			remaining -= written;
+		}
+		return true;
+	}
+
+	bool PipeLineReader::Read(std::vector<std::string>& lines) {
+		char chunk[4096];
+		ssize_t count;
+		do {
+			count = read(mFd, chunk, sizeof(chunk));
+		} while (count < 0 && errno == EINTR);
+		if (count <= 0) return false;
+		mBuffer.append(chunk, count);
+		size_t newline;
+		while ((newline = mBuffer.find('\n')) != std::string::npos) {
+			lines.push_back(mBuffer.substr(0, newline));
+			mBuffer.erase(0, newline + 1);
+		}
+		return true;
+	}
+
+	bool PipeLineReader::ReadLine(std::string& line) {
+		while (true) {
+			size_t newline = mBuffer.find('\n');
+			if (newline != std::string::npos) {
+				line = mBuffer.substr(0, newline);
+				mBuffer.erase(0, newline + 1);
+				return true;
+			}
+			char chunk[4096];
+			ssize_t count = read(mFd, chunk, sizeof(chunk));
+			if (count < 0 && errno == EINTR) continue;
+			if (count <= 0) return false;
+			mBuffer.append(chunk, count);
+		}
+	}
+#else
+	bool WritePipeLine(int fd, const std::string& line) {
+		return false;
+	}
+
+	bool PipeLineReader::Read(std::vector<std::string>& lines) {
+		return false;
+	}
+
+	bool PipeLineReader::ReadLine(std::string& line) {
+		return false;
+	}
+#endif
+} // namespace textextract
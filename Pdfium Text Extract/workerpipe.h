@@ -0,0 +1,82 @@
+#ifndef WORKER_PIPE
+#define WORKER_PIPE
+
+#include <string>
+#include <vector>
+
+#include "pageresult.h"
+
+namespace textextract {
+	/**
+	* Write a message line to a pipe, retrying interrupted and partial writes. Messages
+	* shorter than PIPE_BUF are written atomically, so lines from several threads of a
+	* worker never interleave. POSIX only.
+	*
+	* @param fd File descriptor of the write end of the pipe.
+	* @param line Message, without the trailing newline.
+	*
+	* @returns True if the whole line was written.
+	*/
+	bool WritePipeLine(int fd, const std::string& line);
+
+	/**
+	* @brief Splits the data read from a pipe into message lines. POSIX only.
+	*/
+	class PipeLineReader {
+	private:
+		int mFd;
+		// Data read that does not yet end in a newline.
+		std::string mBuffer;
+
+	public:
+		PipeLineReader(int fd) : mFd(fd) {}
+		/**
+		* Read whatever is available from the pipe, blocking if nothing is.
+		*
+		* @param lines Complete lines read are appended to lines.
+		*
+		* @returns False once the write end of the pipe is closed or the read fails.
+		*/
+		bool Read(std::vector<std::string>& lines);
+		/**
+		* Wait for the next complete line.
+		*
+		* @param line Set to the line read.
+		*
+		* @returns False if the pipe closed before a complete line was read.
+		*/
+		bool ReadLine(std::string& line);
+	};
+
+	/**
+	* Encode a page result as the fields of a message: page number, status and reasons.
+	*
+	* @param result The page result.
+	*
+	* @returns The encoded fields, on a single line.
+	*/
+	std::string EncodePageResult(const PageResult& result);
+	/**
+	* Decode the fields of a message written by EncodePageResult.
+	*
+	* @param fields The encoded fields.
+	* @param result Set to the page result.
+	*
+	* @returns True if the fields held a page result.
+	*/
+	bool DecodePageResult(const std::string& fields, PageResult& result);
+
+	/**
+	* @brief Sends page progress from a worker over a pipe, as S <page> when a page starts,
+	* and E <page result> when it finishes.
+	*/
+	class PipeProgress : public PageProgress {
+	private:
+		int mFd;
+	public:
+		PipeProgress(int fd) : mFd(fd) {}
+		void PageStarted(int pageNumber) override;
+		void PageFinished(const PageResult& result) override;
+	};
+} // namespace textextract
+#endif
@@ -0,0 +1,511 @@
+#include "workersupervisor.h"
+
+#include "concurrencycontroller.h"
+#include "memorystats.h"
+#include "stagetimer.h"
+#include "workerpipe.h"
+
+#include <iostream>
+
+#ifndef _WIN32
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#endif
+
+namespace textextract {
+	nlohmann::json SupervisorReportToJson(const SupervisorReport& report) {
+		nlohmann::json quarantine = nlohmann::json::array();
+		for (const auto& page : report.quarantine) {
+			quarantine.push_back({
+				{"file", page.fileName},
+				{"page", page.pageNumber},
+				{"failures", page.failures} });
+		}
+		nlohmann::json j;
+		j["restarts"] = report.restarts;
+		j["crashes"] = report.crashes;
+		j["page_timeouts"] = report.pageTimeouts;
+		j["heartbeat_timeouts"] = report.heartbeatTimeouts;
+		j["memory_sheds"] = report.memorySheds;
+		if (!report.concurrency.is_null()) j["concurrency"] = report.concurrency;
+		j["quarantine"] = quarantine;
+		return j;
+	}
+
+#ifndef _WIN32
+	namespace {
+		typedef std::chrono::steady_clock Clock;
+
+		std::string JoinPages(const std::set<int>& pages) {
+			if (pages.empty()) return "-";
+			std::string joined;
+			for (int page : pages) {
+				if (!joined.empty()) joined += ",";
+				joined += std::to_string(page);
+			}
+			return joined;
+		}
+
+		std::set<int> SplitPages(const std::string& joined) {
+			std::set<int> pages;
+			if (joined == "-") return pages;
+			std::istringstream stream(joined);
+			std::string page;
+			while (std::getline(stream, page, ',')) pages.insert(std::stoi(page));
+			return pages;
+		}
+
+		// Body of a worker process: run each job read from jobFd until the supervisor
+		// closes the pipe. A heartbeat is sent every interval in which the extraction made
+		// progress, so that a worker stuck inside pdfium stops beating even though this
+		// thread is still running.
+		void WorkerMain(const std::vector<std::filesystem::path>& files, const JobRunner& runner,
+			int jobFd, int resultFd, int heartbeatIntervalMs) {
+			EnableProgress();
+			std::atomic<bool> running{ true };
+			std::thread heartbeat([&]() {
+				uint64_t lastprogress = GetProgress();
+				while (running.load()) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(heartbeatIntervalMs));
+					uint64_t progress = GetProgress();
+					if (progress != lastprogress) WritePipeLine(resultFd, "H");
+					lastprogress = progress;
+				}
+			});
+
+			PipeProgress progress(resultFd);
+			PipeLineReader jobs(jobFd);
+			std::string message;
+			while (jobs.ReadLine(message)) {
+				// A job is J <index> <completed pages> <failed pages> <quarantined pages>.
+				std::istringstream line(message);
+				std::string type, completed, failed, quarantined;
+				DocumentJob job;
+				line >> type >> job.index >> completed >> failed >> quarantined;
+				if (type != "J" || job.index >= files.size()) continue;
+				job.path = files[job.index];
+				job.completedPages = SplitPages(completed);
+				job.failedPages = SplitPages(failed);
+				job.quarantinedPages = SplitPages(quarantined);
+				NoteProgress();
+
+				DocumentResult result = runner(job, &progress);
+				// Done is D <skipped> <pages skipped> <error>.
+				WritePipeLine(resultFd, "D " + std::to_string(result.skipped ? 1 : 0) + " " +
+					std::to_string(result.pagesSkipped) + " " + result.error);
+			}
+			running.store(false);
+			heartbeat.join();
+		}
+
+		struct Worker {
+			pid_t pid = -1;
+			// Supervisor's ends of the job and result pipes.
+			int jobFd = -1;
+			int resultFd = -1;
+			std::unique_ptr<PipeLineReader> reader;
+			bool busy = false;
+			DocumentJob job;
+			// Pages the worker has started and not finished, with the time each started.
+			// Several pages are in flight at once with a page pipeline or page workers.
+			std::map<int, Clock::time_point> pages;
+			Clock::time_point lastMessage;
+
+			// Page a crash or hang is blamed on: the page started last, which is the one
+			// pdfium is working on, or 0 between pages.
+			int GetBlamedPage() const {
+				int blamed = 0;
+				Clock::time_point latest;
+				for (const auto& page : pages) {
+					if (blamed == 0 || page.second >= latest) {
+						blamed = page.first;
+						latest = page.second;
+					}
+				}
+				return blamed;
+			}
+		};
+
+		class Supervisor {
+		private:
+			const std::vector<std::filesystem::path>& mFiles;
+			const SupervisorSettings& mSettings;
+			const JobRunner& mRunner;
+			std::vector<DocumentResult>& mDocuments;
+			SupervisorReport& mReport;
+			std::vector<Worker> mWorkers;
+			std::deque<DocumentJob> mPending;
+			// Reasons for each failure of a page, keyed by document index and page.
+			std::map<std::pair<size_t, int>, std::vector<std::string>> mFailures;
+			// Adjusts the number of active workers when a memory ceiling is set.
+			std::unique_ptr<ConcurrencyController> mController;
+			Clock::time_point mStart;
+			Clock::time_point mLastSample;
+			// Pages finished over the run, and when the controller last sampled.
+			int mPagesFinished = 0;
+			int mPagesAtLastSample = 0;
+
+		public:
+			Supervisor(const std::vector<std::filesystem::path>& files, const SupervisorSettings& settings,
+				const JobRunner& runner, std::vector<DocumentResult>& documents, SupervisorReport& report)
+				: mFiles(files), mSettings(settings), mRunner(runner), mDocuments(documents), mReport(report) {}
+
+			bool Start(Worker& worker) {
+				int jobpipe[2];
+				int resultpipe[2];
+				if (pipe(jobpipe) != 0) return false;
+				if (pipe(resultpipe) != 0) {
+					close(jobpipe[0]);
+					close(jobpipe[1]);
+					return false;
+				}
+				// Output buffered before the fork would otherwise be written by both processes.
+				fflush(stdout);
+				fflush(stderr);
+				pid_t pid = fork();
+				if (pid < 0) {
+					close(jobpipe[0]);
+					close(jobpipe[1]);
+					close(resultpipe[0]);
+					close(resultpipe[1]);
+					return false;
+				}
+				if (pid == 0) {
+					// Each worker leads its own process group, which the page workers it
+					// forks join, so that they are killed along with it.
+					setpgid(0, 0);
+#ifdef __linux__
+					// Outside of the supervisor's group, an interrupt no longer reaches the
+					// worker, so it is killed when the supervisor exits instead.
+					prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+					// The other workers' pipes are closed, so that a worker that dies is seen
+					// as the end of its result pipe.
+					for (const auto& other : mWorkers) {
+						if (other.jobFd >= 0) close(other.jobFd);
+						if (other.resultFd >= 0) close(other.resultFd);
+					}
+					close(jobpipe[1]);
+					close(resultpipe[0]);
+					signal(SIGPIPE, SIG_DFL);
+					int interval = std::max(mSettings.heartbeatTimeoutMs / 4, 10);
+					WorkerMain(mFiles, mRunner, jobpipe[0], resultpipe[1], interval);
+					fflush(stdout);
+					fflush(stderr);
+					_exit(0);
+				}
+				// Set from both sides, so that the group exists before the worker can be stopped.
+				setpgid(pid, pid);
+				close(jobpipe[0]);
+				close(resultpipe[1]);
+				worker = Worker();
+				worker.pid = pid;
+				worker.jobFd = jobpipe[1];
+				worker.resultFd = resultpipe[0];
+				worker.reader = std::make_unique<PipeLineReader>(worker.resultFd);
+				worker.lastMessage = Clock::now();
+				return true;
+			}
+
+			void Assign(Worker& worker, DocumentJob job) {
+				worker.busy = true;
+				worker.pages.clear();
+				worker.job = job;
+				worker.lastMessage = Clock::now();
+				WritePipeLine(worker.jobFd, "J " + std::to_string(job.index) + " " +
+					JoinPages(job.completedPages) + " " + JoinPages(job.failedPages) + " " +
+					JoinPages(job.quarantinedPages));
+			}
+
+			void HandleMessage(Worker& worker, const std::string& message) {
+				worker.lastMessage = Clock::now();
+				if (message.empty() || message[0] == 'H') return;
+				DocumentResult& document = mDocuments[worker.job.index];
+				std::istringstream line(message);
+				std::string type;
+				line >> type;
+				if (type == "S") {
+					int page = 0;
+					line >> page;
+					worker.pages[page] = Clock::now();
+				}
+				else if (type == "E") {
+					PageResult result;
+					if (!DecodePageResult(message.substr(2), result)) return;
+					document.pages.push_back(result);
+					worker.job.completedPages.insert(result.pageNumber);
+					if (result.status == PageStatus::FAILED) worker.job.failedPages.insert(result.pageNumber);
+					worker.pages.erase(result.pageNumber);
+					mPagesFinished++;
+				}
+				else if (type == "D") {
+					int skipped = 0;
+					int pagesskipped = 0;
+					line >> skipped >> pagesskipped;
+					std::string error;
+					std::getline(line >> std::ws, error);
+					document.skipped = skipped != 0;
+					document.pagesSkipped += pagesskipped;
+					document.error = error;
+					worker.busy = false;
+					worker.pages.clear();
+				}
+			}
+
+			// Read whatever the worker has sent, returning false once its pipe is closed.
+			bool Read(Worker& worker) {
+				std::vector<std::string> messages;
+				bool open = worker.reader->Read(messages);
+				for (const auto& message : messages) HandleMessage(worker, message);
+				return open;
+			}
+
+			// Kill and reap a worker along with any page workers it forked, returning its wait status.
+			int Stop(Worker& worker) {
+				kill(-worker.pid, SIGKILL);
+				kill(worker.pid, SIGKILL);
+				int status = 0;
+				waitpid(worker.pid, &status, 0);
+				close(worker.jobFd);
+				close(worker.resultFd);
+				worker.pid = -1;
+				worker.jobFd = -1;
+				worker.resultFd = -1;
+				return status;
+			}
+
+			// Kill and reap a worker, and hand its document out again without the pages it
+			// finished. The failure counts against page, 0 when it was outside of any page.
+			void Replace(Worker& worker, const std::string& reason, int page) {
+				int status = Stop(worker);
+
+				if (worker.busy) {
+					std::string failure = reason;
+					if (WIFSIGNALED(status) && reason == "crashed") {
+						failure += " with signal " + std::to_string(WTERMSIG(status));
+					}
+					else if (WIFEXITED(status) && reason == "crashed") {
+						failure += " with exit code " + std::to_string(WEXITSTATUS(status));
+					}
+					DocumentJob job = worker.job;
+					const std::string& filename = mDocuments[job.index].fileName;
+					std::cerr << "Worker " << failure << " on " << filename << " page " << page << "." << std::endl;
+					auto& failures = mFailures[{ job.index, page }];
+					failures.push_back(failure);
+					if (static_cast<int>(failures.size()) >= mSettings.maxPageFailures) {
+						QuarantinedPage quarantined;
+						quarantined.fileName = filename;
+						quarantined.pageNumber = page;
+						quarantined.failures = failures;
+						mReport.quarantine.push_back(quarantined);
+						if (page == 0) {
+							// Failing outside of a page means the document cannot be opened by a worker.
+							mDocuments[job.index].error = "Worker " + failure + " outside of any page.";
+						}
+						else {
+							job.quarantinedPages.insert(page);
+							mPending.push_front(job);
+						}
+					}
+					else {
+						mPending.push_front(job);
+					}
+				}
+				worker.busy = false;
+				mReport.restarts++;
+				if (!Start(worker)) {
+					std::cerr << "Failed to start a replacement worker." << std::endl;
+				}
+			}
+
+			// Stop a busy worker and hand its document out again without the pages it finished.
+			// The worker using the most memory is left running, since stopping it would only
+			// see the same document grow back to that size, and the next largest is stopped to
+			// make room for it. Unlike a crash, this does not count against the page.
+			void Shed() {
+				std::vector<std::pair<uint64_t, Worker*>> busy;
+				for (auto& worker : mWorkers) {
+					if (worker.pid > 0 && worker.busy) busy.push_back({ ReadResidentSetSize(worker.pid), &worker });
+				}
+				if (busy.size() < 2) return;
+				std::sort(busy.begin(), busy.end(),
+					[](const auto& a, const auto& b) { return a.first > b.first; });
+				Worker* shed = busy[1].second;
+				// Pages finished just before the kill are still in the pipe.
+				Read(*shed);
+				std::cerr << "Stopping the worker on " << mDocuments[shed->job.index].fileName <<
+					" to stay under the memory ceiling." << std::endl;
+				Stop(*shed);
+				if (shed->busy) mPending.push_front(shed->job);
+				shed->busy = false;
+				mReport.memorySheds++;
+				if (!Start(*shed)) std::cerr << "Failed to start a replacement worker." << std::endl;
+			}
+
+			// Sample memory use and throughput, and let the controller adjust the active workers.
+			void Control() {
+				auto now = Clock::now();
+				double intervalms = std::chrono::duration<double, std::milli>(now - mLastSample).count();
+				if (!mController || intervalms < mSettings.controlIntervalMs) return;
+				ConcurrencySample sample;
+				sample.timeMs = std::chrono::duration<double, std::milli>(now - mStart).count();
+				sample.intervalMs = intervalms;
+				sample.usedBytes = ReadProcessMemory().rssBytes;
+				for (const auto& worker : mWorkers) {
+					if (worker.pid <= 0) continue;
+					uint64_t bytes = ReadResidentSetSize(worker.pid);
+					sample.usedBytes += bytes;
+					if (worker.busy) {
+						sample.busyWorkers++;
+						sample.largestWorkerBytes = std::max(sample.largestWorkerBytes, bytes);
+					}
+				}
+				sample.availableBytes = ReadAvailableMemory();
+				sample.pagesFinished = mPagesFinished - mPagesAtLastSample;
+				sample.workPending = !mPending.empty();
+				mPagesAtLastSample = mPagesFinished;
+				mLastSample = now;
+				if (mController->Update(sample) == ConcurrencyAction::SHED) Shed();
+			}
+
+			// Number of workers that may be busy at once.
+			int GetActiveLimit() const {
+				return mController ? mController->GetWorkers() : static_cast<int>(mWorkers.size());
+			}
+
+			void Run() {
+				for (size_t i = 0; i < mFiles.size(); i++) {
+					mDocuments[i].fileName = mFiles[i].filename().string();
+					DocumentJob job;
+					job.index = i;
+					job.path = mFiles[i];
+					mPending.push_back(job);
+				}
+				mWorkers.resize(std::max(mSettings.jobs, 1));
+				mStart = Clock::now();
+				mLastSample = mStart;
+				if (mSettings.memoryCeilingBytes > 0) {
+					ConcurrencySettings concurrency;
+					concurrency.memoryCeilingBytes = mSettings.memoryCeilingBytes;
+					concurrency.maxWorkers = static_cast<int>(mWorkers.size());
+					mController = std::make_unique<ConcurrencyController>(concurrency);
+				}
+				for (auto& worker : mWorkers) {
+					if (!Start(worker)) std::cerr << "Failed to start a worker." << std::endl;
+				}
+
+				while (true) {
+					bool anybusy = false;
+					int busy = static_cast<int>(std::count_if(mWorkers.begin(), mWorkers.end(),
+						[](const Worker& w) { return w.busy; }));
+					for (auto& worker : mWorkers) {
+						if (worker.pid > 0 && !worker.busy && !mPending.empty() && busy < GetActiveLimit()) {
+							Assign(worker, mPending.front());
+							mPending.pop_front();
+							busy++;
+						}
+						anybusy = anybusy || worker.busy;
+					}
+					if (!anybusy) {
+						if (mPending.empty()) break;
+						// Every worker failed to start, the remaining documents cannot be processed.
+						bool anyrunning = false;
+						for (const auto& worker : mWorkers) anyrunning = anyrunning || worker.pid > 0;
+						if (!anyrunning) {
+							for (const auto& job : mPending) mDocuments[job.index].error = "No worker could be started.";
+							break;
+						}
+					}
+
+					std::vector<pollfd> fds;
+					std::vector<Worker*> polled;
+					for (auto& worker : mWorkers) {
+						if (worker.pid <= 0 || worker.resultFd < 0) continue;
+						fds.push_back({ worker.resultFd, POLLIN, 0 });
+						polled.push_back(&worker);
+					}
+					int ready = poll(fds.data(), fds.size(), 100);
+					if (ready < 0 && errno != EINTR) {
+						std::cerr << "Error waiting on workers: " << strerror(errno) << std::endl;
+						break;
+					}
+					for (size_t i = 0; i < fds.size() && ready > 0; i++) {
+						if (fds[i].revents == 0) continue;
+						Worker& worker = *polled[i];
+						if (!Read(worker)) {
+							if (worker.busy) mReport.crashes++;
+							Replace(worker, "crashed", worker.GetBlamedPage());
+						}
+					}
+
+					auto now = Clock::now();
+					for (auto& worker : mWorkers) {
+						if (worker.pid <= 0 || !worker.busy) continue;
+						// The page that has been in flight longest is the one timed.
+						int timedpage = 0;
+						Clock::time_point timedstart = now;
+						for (const auto& page : worker.pages) {
+							if (page.second < timedstart) {
+								timedpage = page.first;
+								timedstart = page.second;
+							}
+						}
+						auto sincepage = std::chrono::duration_cast<std::chrono::milliseconds>(now - timedstart).count();
+						auto sincemessage = std::chrono::duration_cast<std::chrono::milliseconds>(now - worker.lastMessage).count();
+						if (mSettings.pageTimeoutMs > 0 && timedpage > 0 && sincepage > mSettings.pageTimeoutMs) {
+							mReport.pageTimeouts++;
+							Replace(worker, "exceeded the " + std::to_string(mSettings.pageTimeoutMs) + "ms page timeout", timedpage);
+						}
+						else if (mSettings.heartbeatTimeoutMs > 0 && sincemessage > mSettings.heartbeatTimeoutMs) {
+							mReport.heartbeatTimeouts++;
+							Replace(worker, "stopped sending heartbeats", worker.GetBlamedPage());
+						}
+					}
+					Control();
+				}
+				if (mController) mReport.concurrency = mController->DecisionsToJson();
+
+				for (auto& worker : mWorkers) {
+					if (worker.pid <= 0) continue;
+					// Closing the job pipe tells the worker to exit.
+					close(worker.jobFd);
+					int status = 0;
+					waitpid(worker.pid, &status, 0);
+					close(worker.resultFd);
+				}
+			}
+		};
+	} // namespace
+
+	bool RunSupervised(const std::vector<std::filesystem::path>& files, const SupervisorSettings& settings,
+		const JobRunner& runner, std::vector<DocumentResult>& documents, SupervisorReport& report) {
+		// Jobs written to a worker that has just died must not kill the supervisor.
+		signal(SIGPIPE, SIG_IGN);
+		documents.assign(files.size(), DocumentResult());
+		report = SupervisorReport();
+		Supervisor supervisor(files, settings, runner, documents, report);
+		supervisor.Run();
+		return true;
+	}
+#else
+	bool RunSupervised(const std::vector<std::filesystem::path>& files, const SupervisorSettings& settings,
+		const JobRunner& runner, std::vector<DocumentResult>& documents, SupervisorReport& report) {
+		std::cerr << "Worker processes are only supported on POSIX systems, processing in a single process." << std::endl;
+		return false;
+	}
+#endif
+} // namespace textextract
@@ -0,0 +1,117 @@
+#ifndef WORKER_SUPERVISOR
+#define WORKER_SUPERVISOR
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "pageresult.h"
+
+namespace textextract {
+	/**
+	* @brief A document handed to a worker, along with the pages it should not process again.
+	*/
+	struct DocumentJob {
+		// Index of the document in the list of documents being processed.
+		size_t index = 0;
+		std::filesystem::path path;
+		// Pages already processed by a worker that has since died.
+		std::set<int> completedPages;
+		// Completed pages that failed, which keep the document from being recorded as
+		// complete by the worker that finishes it.
+		std::set<int> failedPages;
+		// Pages that crashed or hung a worker too many times, reported as failed without
+		// being processed.
+		std::set<int> quarantinedPages;
+	};
+
+	// Processes a single document job in a worker, reporting each page to the progress.
+	using JobRunner = std::function<DocumentResult(const DocumentJob& job, PageProgress* progress)>;
+
+	/**
+	* @brief Limits the supervisor applies to its workers.
+	*/
+	struct SupervisorSettings {
+		// Number of worker processes.
+		int jobs = 1;
+		// Time a single page may take before its worker is treated as hung, 0 for no limit.
+		int pageTimeoutMs = 0;
+		// Time without any message from a busy worker before it is treated as hung. Workers
+		// only send heartbeats while their extraction makes progress.
+		int heartbeatTimeoutMs = 60000;
+		// Number of times a page may crash or hang a worker before it is quarantined.
+		int maxPageFailures = 2;
+		// Memory the supervisor and its workers may use together, in bytes. When set, jobs is
+		// the most workers, and the number active is adjusted to stay under the ceiling.
+		uint64_t memoryCeilingBytes = 0;
+		// Time between memory and throughput samples when adjusting the workers, in milliseconds.
+		int controlIntervalMs = 1000;
+	};
+
+	/**
+	* @brief A page that was quarantined after repeatedly crashing or hanging workers.
+	*/
+	struct QuarantinedPage {
+		std::string fileName;
+		// One based page number, 0 when the worker failed outside of any page.
+		int pageNumber = 0;
+		// Reason for each failure, such as the signal the worker was killed by.
+		std::vector<std::string> failures;
+	};
+
+	/**
+	* @brief Worker restarts and quarantined pages of a supervised run.
+	*/
+	struct SupervisorReport {
+		// Number of workers started to replace workers that died or were killed.
+		int restarts = 0;
+		// Workers that exited or were killed by a signal while processing a document.
+		int crashes = 0;
+		// Workers killed by the page watchdog.
+		int pageTimeouts = 0;
+		// Workers killed for not sending a heartbeat.
+		int heartbeatTimeouts = 0;
+		// Workers stopped to bring memory back under the ceiling, their documents handed out again.
+		int memorySheds = 0;
+		// Changes to the number of active workers, null when the worker count was fixed.
+		nlohmann::json concurrency;
+		std::vector<QuarantinedPage> quarantine;
+	};
+
+	/**
+	* Convert the supervisor report to JSON for the page report.
+	*
+	* @param report The supervisor report.
+	*
+	* @returns The report as JSON.
+	*/
+	nlohmann::json SupervisorReportToJson(const SupervisorReport& report);
+
+	/**
+	* Process documents in worker processes, so that a page that crashes or hangs pdfium
+	* only takes down its own worker. Workers are forked from the calling process, and send
+	* the start and result of each page along with a heartbeat over a pipe. A worker that
+	* dies, stops sending heartbeats, or spends longer than the page timeout on a page is
+	* killed and replaced, and its document is handed out again without the pages it had
+	* already finished. A page that fails maxPageFailures times is quarantined, and
+	* reported as failed without being processed again. With a memory ceiling, workers are
+	* activated one at a time as memory and throughput allow, and stopped before the
+	* ceiling or the system's available memory runs out. Only supported on POSIX systems.
+	*
+	* @param files Paths of the documents to process.
+	* @param settings Number of workers and their limits.
+	* @param runner Processes a document job, called in the worker processes.
+	* @param documents Set to the results of each document, in the order of files.
+	* @param report Set to the worker restarts and quarantined pages.
+	*
+	* @returns False if worker processes are not supported, in which case nothing was processed.
+	*/
+	bool RunSupervised(const std::vector<std::filesystem::path>& files, const SupervisorSettings& settings,
+		const JobRunner& runner, std::vector<DocumentResult>& documents, SupervisorReport& report);
+} // namespace textextract
+#endif